@@ -0,0 +1,127 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// On-demand engine: A* search per query. The heuristic is a lower bound of the route weight
+// to the target and must be consistent: h(u, t) <= weight(u -> v) + h(v, t) for every edge,
+// then the first time the target is taken from the heap its route is the shortest one.
+// The graph should be frozen
+template <typename Weight>
+class AStarRouter final : public RouterEngine<Weight> {
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+
+    AStarRouter(const Graph& graph, Heuristic heuristic);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    SearchStats GetSearchStats() const {
+        return search_counters_.Get();
+    }
+
+private:
+    // weight + heuristic, weight, vertex
+    using QueueItem = std::tuple<Weight, Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    const Graph& graph_;
+    Heuristic heuristic_;
+    mutable SearchCounters search_counters_;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, Heuristic heuristic)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo>
+AStarRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+    std::vector<bool> is_settled(vertex_count, false);
+
+    Queue queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({heuristic_(from, to), ZERO_WEIGHT, from});
+    size_t settled_count = 0;
+
+    while (!queue.empty()) {
+        const auto [estimate, weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > *weights[vertex] || is_settled[vertex]) {
+            continue;  // stale item
+        }
+        is_settled[vertex] = true;
+        ++settled_count;
+        if (vertex == to) {
+            break;
+        }
+        // linear scan of the CSR row, edge ids go in parallel
+        auto incident_edge = graph_.GetIncidentEdges(vertex).begin();
+        for (const auto& edge : graph_.GetAdjacentEdges(vertex)) {
+            const EdgeId edge_id = *incident_edge++;
+            const Weight candidate_weight = weight + edge.weight;
+            auto& route_weight = weights[edge.to];
+            if (!route_weight || candidate_weight < *route_weight) {
+                route_weight = candidate_weight;
+                prev_edges[edge.to] = edge_id;
+                queue.push({candidate_weight + heuristic_(edge.to, to), candidate_weight, edge.to});
+            }
+        }
+    }
+    search_counters_.Add(settled_count);
+
+    if (!weights[to]) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = prev_edges[to]; edge_id != NO_EDGE;
+         edge_id = prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{*weights[to], std::move(edges)};
+}
+
+}  // namespace graph
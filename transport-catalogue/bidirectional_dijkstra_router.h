@@ -0,0 +1,194 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// On-demand engine: Dijkstra forward from the origin and backward from the destination
+// over a reverse copy of the frozen graph (same edge ids), the smaller heap top goes next.
+// Stops when the sum of the heap tops reaches the best meeting weight found so far
+template <typename Weight>
+class BidirectionalDijkstraRouter final : public RouterEngine<Weight> {
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit BidirectionalDijkstraRouter(const Graph& graph);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // the reverse graph is built again, O(V + E)
+    bool Update(const std::vector<EdgeId>& changed_edges) override;
+
+    SearchStats GetSearchStats() const {
+        return search_counters_.Get();
+    }
+
+private:
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    // one direction: weights from (to) its root and the edges towards the root
+    struct Side {
+        const Graph& graph;
+        std::vector<std::optional<Weight>> weights;
+        std::vector<EdgeId> tree_edges;
+        Queue queue;
+    };
+
+    void BuildReverseGraph();
+
+    // settles the top of `side`, updates the meeting with the labels of `other`
+    void Step(Side& side, const Side& other, std::optional<Weight>& best_weight, VertexId& meeting,
+              size_t& settled_count) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    const Graph& graph_;
+    Graph reverse_graph_;
+    mutable SearchCounters search_counters_;
+};
+
+template <typename Weight>
+BidirectionalDijkstraRouter<Weight>::BidirectionalDijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    BuildReverseGraph();
+}
+
+template <typename Weight>
+bool BidirectionalDijkstraRouter<Weight>::Update(const std::vector<EdgeId>& changed_edges) {
+    (void)changed_edges;
+    BuildReverseGraph();
+    return true;
+}
+
+template <typename Weight>
+void BidirectionalDijkstraRouter<Weight>::BuildReverseGraph() {
+    // edge i of the reverse graph is edge i of the graph turned around, removed ones too
+    reverse_graph_ = Graph(graph_.GetVertexCount());
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        reverse_graph_.AddEdge({edge.to, edge.from, edge.weight});
+    }
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        if (!graph_.HasEdge(edge_id)) {
+            reverse_graph_.RemoveEdge(edge_id);
+        }
+    }
+    reverse_graph_.Freeze();
+}
+
+template <typename Weight>
+std::optional<typename BidirectionalDijkstraRouter<Weight>::RouteInfo>
+BidirectionalDijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    Side forward{graph_, std::vector<std::optional<Weight>>(vertex_count),
+                 std::vector<EdgeId>(vertex_count, NO_EDGE), {}};
+    Side backward{reverse_graph_, std::vector<std::optional<Weight>>(vertex_count),
+                  std::vector<EdgeId>(vertex_count, NO_EDGE), {}};
+    forward.weights[from] = ZERO_WEIGHT;
+    forward.queue.push({ZERO_WEIGHT, from});
+    backward.weights[to] = ZERO_WEIGHT;
+    backward.queue.push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting = from;
+    if (from == to) {
+        best_weight = ZERO_WEIGHT;
+    }
+    size_t settled_count = 0;
+
+    // an exhausted side has settled everything it reaches, the meeting is final then
+    while (!forward.queue.empty() && !backward.queue.empty()) {
+        const Weight forward_top = forward.queue.top().first;
+        const Weight backward_top = backward.queue.top().first;
+        if (best_weight && forward_top + backward_top >= *best_weight) {
+            break;
+        }
+        if (forward_top <= backward_top) {
+            Step(forward, backward, best_weight, meeting, settled_count);
+        } else {
+            Step(backward, forward, best_weight, meeting, settled_count);
+        }
+    }
+    search_counters_.Add(settled_count);
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = forward.tree_edges[meeting]; edge_id != NO_EDGE;
+         edge_id = forward.tree_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (EdgeId edge_id = backward.tree_edges[meeting]; edge_id != NO_EDGE;
+         edge_id = backward.tree_edges[graph_.GetEdge(edge_id).to])
+    {
+        edges.push_back(edge_id);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+void BidirectionalDijkstraRouter<Weight>::Step(Side& side, const Side& other, std::optional<Weight>& best_weight,
+                                               VertexId& meeting, size_t& settled_count) const {
+    const auto [weight, vertex] = side.queue.top();
+    side.queue.pop();
+    if (weight > *side.weights[vertex]) {
+        return;  // stale item
+    }
+    ++settled_count;
+
+    auto incident_edge = side.graph.GetIncidentEdges(vertex).begin();
+    for (const auto& edge : side.graph.GetAdjacentEdges(vertex)) {
+        const EdgeId edge_id = *incident_edge++;
+        const Weight candidate_weight = weight + edge.weight;
+        auto& route_weight = side.weights[edge.to];
+        if (route_weight && candidate_weight >= *route_weight) {
+            continue;
+        }
+        route_weight = candidate_weight;
+        side.tree_edges[edge.to] = edge_id;
+        side.queue.push({candidate_weight, edge.to});
+
+        // every improved label is checked against the other side
+        if (const auto& other_weight = other.weights[edge.to]) {
+            const Weight through_weight = candidate_weight + *other_weight;
+            if (!best_weight || through_weight < *best_weight) {
+                best_weight = through_weight;
+                meeting = edge.to;
+            }
+        }
+    }
+}
+
+}  // namespace graph
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Graph over the terminal vertices only: vertex i is terminals[i], edge u -> v is the lightest
+// route of the source graph from u to v with no terminal inside, routes[edge] are its edges.
+// Every route between terminals is a chain of such routes, so the shortest ones are the same
+template <typename Weight>
+struct CondensedGraph {
+    DirectedWeightedGraph<Weight> graph;
+    std::vector<std::vector<EdgeId>> routes;
+};
+
+// one search per terminal which stops at other terminals, source graph should be frozen;
+// the condensed graph is frozen too
+template <typename Weight>
+CondensedGraph<Weight> CondenseGraph(const DirectedWeightedGraph<Weight>& graph,
+                                     const std::vector<VertexId>& terminals) {
+    using QueueItem = std::pair<Weight, VertexId>;
+    static constexpr VertexId NO_TERMINAL = std::numeric_limits<VertexId>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr Weight MAX_WEIGHT = std::numeric_limits<Weight>::max();
+
+    const size_t vertex_count = graph.GetVertexCount();
+    std::vector<VertexId> terminal_ids(vertex_count, NO_TERMINAL);
+    for (VertexId id = 0; id < terminals.size(); ++id) {
+        terminal_ids.at(terminals[id]) = id;
+    }
+
+    CondensedGraph<Weight> condensed{DirectedWeightedGraph<Weight>(terminals.size()), {}};
+    std::vector<Weight> weights(vertex_count, MAX_WEIGHT);
+    std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+    std::vector<VertexId> touched;
+
+    for (VertexId from_id = 0; from_id < terminals.size(); ++from_id) {
+        const VertexId from = terminals[from_id];
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        weights[from] = Weight{};
+        touched.push_back(from);
+        queue.push({Weight{}, from});
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) {
+                continue;  // stale item
+            }
+            if (vertex != from && terminal_ids[vertex] != NO_TERMINAL) {
+                std::vector<EdgeId> route;
+                for (EdgeId edge_id = prev_edges[vertex]; edge_id != NO_EDGE;
+                     edge_id = prev_edges[graph.GetEdge(edge_id).from])
+                {
+                    route.push_back(edge_id);
+                }
+                std::reverse(route.begin(), route.end());
+                condensed.graph.AddEdge({from_id, terminal_ids[vertex], weight});
+                condensed.routes.push_back(std::move(route));
+                continue;  // the search doesn't go through terminals
+            }
+
+            auto incident_edge = graph.GetIncidentEdges(vertex).begin();
+            for (const auto& edge : graph.GetAdjacentEdges(vertex)) {
+                const EdgeId edge_id = *incident_edge++;
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < weights[edge.to]) {
+                    if (weights[edge.to] == MAX_WEIGHT) {
+                        touched.push_back(edge.to);
+                    }
+                    weights[edge.to] = candidate_weight;
+                    prev_edges[edge.to] = edge_id;
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+
+        for (const VertexId vertex : touched) {
+            weights[vertex] = MAX_WEIGHT;
+            prev_edges[vertex] = NO_EDGE;
+        }
+        touched.clear();
+    }
+
+    condensed.graph.Freeze();
+    return condensed;
+}
+
+}  // namespace graph
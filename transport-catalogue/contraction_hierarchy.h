@@ -0,0 +1,506 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace transport {
+    struct Serial;
+}
+
+namespace graph {
+
+// Contraction hierarchies engine. Vertices are contracted one by one at make_base,
+// shortcuts keep distances between the remaining ones. A query is a bidirectional
+// Dijkstra which only goes up in the vertex order, shortcuts are unpacked back
+// into the original edges of the graph.
+template <typename Weight>
+class ContractionHierarchy final : public RouterEngine<Weight> {
+
+    friend class transport::Serial;
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    // Shortcut from -> to replaces edges first + second. Edge ids are augmented:
+    // ids below graph.GetEdgeCount() are the graph edges, shortcut i has id GetEdgeCount() + i
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first;
+        EdgeId second;
+    };
+
+    // preprocessing: computes the vertex order and the shortcuts
+    explicit ContractionHierarchy(const Graph& graph);
+
+    // restores preprocessed hierarchy (f.e. from the base file)
+    ContractionHierarchy(const Graph& graph, std::vector<size_t> ranks, std::vector<Shortcut> shortcuts);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    size_t GetShortcutCount() const {
+        return shortcuts_.size();
+    }
+
+private:
+    struct Arc {
+        VertexId to;
+        Weight weight;
+        EdgeId edge_id;
+    };
+
+    struct SearchSpace {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> edges;
+        std::vector<VertexId> touched;
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    // witness search stops after so many settled vertices, a shortcut is added then;
+    // priority estimation uses the shorter search
+    static constexpr size_t WITNESS_SETTLE_LIMIT = 64;
+    static constexpr size_t ESTIMATE_SETTLE_LIMIT = 8;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight MAX_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    VertexId GetFrom(EdgeId edge_id) const {
+        return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).from
+                                               : shortcuts_[edge_id - graph_.GetEdgeCount()].from;
+    }
+    VertexId GetTo(EdgeId edge_id) const {
+        return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).to
+                                               : shortcuts_[edge_id - graph_.GetEdgeCount()].to;
+    }
+    Weight GetWeight(EdgeId edge_id) const {
+        return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).weight
+                                               : shortcuts_[edge_id - graph_.GetEdgeCount()].weight;
+    }
+
+    void Contract();
+    size_t ContractVertex(VertexId vertex, bool add_shortcuts);
+    void ResetWitnesses();
+    void FindWitnesses(VertexId source, VertexId skipped, Weight max_weight, size_t target_count,
+                       size_t settle_limit);
+    void BuildSearchGraph();
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    const Graph& graph_;
+    std::vector<size_t> ranks_;
+    std::vector<Shortcut> shortcuts_;
+
+    // search graph: up arcs go to higher ranks, down arcs are reversed edges from higher ranks
+    std::vector<size_t> up_offsets_;
+    std::vector<Arc> up_arcs_;
+    std::vector<size_t> down_offsets_;
+    std::vector<Arc> down_arcs_;
+
+    // preprocessing state, released after Contract()
+    std::vector<std::vector<EdgeId>> out_edges_;
+    std::vector<std::vector<EdgeId>> in_edges_;
+    std::vector<bool> contracted_;
+    std::vector<Weight> witness_weights_;
+    std::vector<VertexId> witness_touched_;
+    std::vector<bool> witness_targets_;
+    std::vector<QueueItem> witness_queue_;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : graph_(graph)
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    Contract();
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, std::vector<size_t> ranks,
+                                                   std::vector<Shortcut> shortcuts)
+    : graph_(graph)
+    , ranks_(std::move(ranks))
+    , shortcuts_(std::move(shortcuts))
+{
+    if (ranks_.size() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Vertex ranks don't match the graph");
+    }
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::ResetWitnesses() {
+    for (const VertexId vertex : witness_touched_) {
+        witness_weights_[vertex] = MAX_WEIGHT;
+    }
+    witness_touched_.clear();
+}
+
+// Dijkstra from source avoiding skipped vertex, stops when all marked targets are settled
+template <typename Weight>
+void ContractionHierarchy<Weight>::FindWitnesses(VertexId source, VertexId skipped, Weight max_weight,
+                                                 size_t target_count, size_t settle_limit) {
+    ResetWitnesses();
+
+    // heap storage is kept between the searches
+    auto& queue = witness_queue_;
+    const std::greater<QueueItem> queue_order;
+    queue.clear();
+    witness_weights_[source] = ZERO_WEIGHT;
+    witness_touched_.push_back(source);
+    queue.push_back({ZERO_WEIGHT, source});
+
+    size_t settled = 0;
+    while (!queue.empty() && settled < settle_limit) {
+        std::pop_heap(queue.begin(), queue.end(), queue_order);
+        const auto [weight, vertex] = queue.back();
+        queue.pop_back();
+        if (weight > witness_weights_[vertex]) {
+            continue;
+        }
+        if (weight > max_weight) {
+            break;
+        }
+        ++settled;
+        if (witness_targets_[vertex] && --target_count == 0) {
+            break;
+        }
+        for (const EdgeId edge_id : out_edges_[vertex]) {
+            const VertexId to = GetTo(edge_id);
+            if (to == skipped || contracted_[to]) {
+                continue;
+            }
+            const Weight candidate_weight = weight + GetWeight(edge_id);
+            if (candidate_weight < witness_weights_[to]) {
+                if (witness_weights_[to] == MAX_WEIGHT) {
+                    witness_touched_.push_back(to);
+                }
+                witness_weights_[to] = candidate_weight;
+                queue.push_back({candidate_weight, to});
+                std::push_heap(queue.begin(), queue.end(), queue_order);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+size_t ContractionHierarchy<Weight>::ContractVertex(VertexId vertex, bool add_shortcuts) {
+    size_t shortcut_count = 0;
+
+    // targets reachable only through the vertex can't have witnesses
+    Weight max_out_weight = ZERO_WEIGHT;
+    size_t target_count = 0;
+    for (const EdgeId out_id : out_edges_[vertex]) {
+        const VertexId to = GetTo(out_id);
+        if (contracted_[to] || to == vertex || witness_targets_[to]) {
+            continue;
+        }
+        max_out_weight = std::max(max_out_weight, GetWeight(out_id));
+        const auto& to_in_edges = in_edges_[to];
+        if (std::any_of(to_in_edges.begin(), to_in_edges.end(),
+                        [&](EdgeId edge_id) { return GetFrom(edge_id) != vertex; })) {
+            witness_targets_[to] = true;
+            ++target_count;
+        }
+    }
+
+    for (const EdgeId in_id : in_edges_[vertex]) {
+        const VertexId from = GetFrom(in_id);
+        if (contracted_[from] || from == vertex) {
+            continue;
+        }
+        const Weight in_weight = GetWeight(in_id);
+        if (target_count > 0) {
+            FindWitnesses(from, vertex, in_weight + max_out_weight, target_count,
+                          add_shortcuts ? WITNESS_SETTLE_LIMIT : ESTIMATE_SETTLE_LIMIT);
+        } else {
+            ResetWitnesses();
+        }
+
+        for (const EdgeId out_id : out_edges_[vertex]) {
+            const VertexId to = GetTo(out_id);
+            if (contracted_[to] || to == vertex || to == from) {
+                continue;
+            }
+            const Weight shortcut_weight = in_weight + GetWeight(out_id);
+            if (witness_weights_[to] <= shortcut_weight) {
+                continue;
+            }
+            // other shortcuts from the same vertex are witnesses too
+            witness_weights_[to] = shortcut_weight;
+            witness_touched_.push_back(to);
+            ++shortcut_count;
+
+            if (add_shortcuts) {
+                const EdgeId shortcut_id = graph_.GetEdgeCount() + shortcuts_.size();
+                shortcuts_.push_back({from, to, shortcut_weight, in_id, out_id});
+                out_edges_[from].push_back(shortcut_id);
+                in_edges_[to].push_back(shortcut_id);
+            }
+        }
+    }
+    for (const EdgeId out_id : out_edges_[vertex]) {
+        witness_targets_[GetTo(out_id)] = false;
+    }
+    return shortcut_count;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Contract() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    out_edges_.assign(vertex_count, {});
+    in_edges_.assign(vertex_count, {});
+    contracted_.assign(vertex_count, false);
+    witness_weights_.assign(vertex_count, MAX_WEIGHT);
+    witness_touched_.clear();
+    witness_targets_.assign(vertex_count, false);
+
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (graph_.HasEdge(edge_id) && edge.from != edge.to) {
+            out_edges_[edge.from].push_back(edge_id);
+            in_edges_[edge.to].push_back(edge_id);
+        }
+    }
+
+    // priority = edge difference + contracted neighbours, updated lazily
+    std::vector<size_t> contracted_neighbours(vertex_count, 0);
+    auto priority = [&](VertexId vertex) {
+        const long long added = static_cast<long long>(ContractVertex(vertex, false));
+        const long long removed = static_cast<long long>(in_edges_[vertex].size() + out_edges_[vertex].size());
+        return added - removed + static_cast<long long>(contracted_neighbours[vertex]);
+    };
+
+    using PriorityItem = std::pair<long long, VertexId>;
+    std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.push({priority(vertex), vertex});
+    }
+
+    ranks_.assign(vertex_count, 0);
+    size_t rank = 0;
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        if (contracted_[vertex]) {
+            continue;
+        }
+        const long long current_priority = priority(vertex);
+        if (!queue.empty() && current_priority > queue.top().first) {
+            queue.push({current_priority, vertex});
+            continue;
+        }
+
+        ContractVertex(vertex, true);
+        contracted_[vertex] = true;
+        ranks_[vertex] = rank++;
+
+        // drop arcs to the contracted vertex from neighbours' lists
+        auto drop_contracted = [this](std::vector<EdgeId>& edge_ids, bool by_target) {
+            edge_ids.erase(std::remove_if(edge_ids.begin(), edge_ids.end(), [&](EdgeId edge_id) {
+                               return contracted_[by_target ? GetTo(edge_id) : GetFrom(edge_id)];
+                           }), edge_ids.end());
+        };
+        for (const EdgeId edge_id : in_edges_[vertex]) {
+            const VertexId neighbour = GetFrom(edge_id);
+            if (!contracted_[neighbour]) {
+                ++contracted_neighbours[neighbour];
+                drop_contracted(out_edges_[neighbour], true);
+            }
+        }
+        for (const EdgeId edge_id : out_edges_[vertex]) {
+            const VertexId neighbour = GetTo(edge_id);
+            if (!contracted_[neighbour]) {
+                ++contracted_neighbours[neighbour];
+                drop_contracted(in_edges_[neighbour], false);
+            }
+        }
+    }
+
+    out_edges_.clear();
+    out_edges_.shrink_to_fit();
+    in_edges_.clear();
+    in_edges_.shrink_to_fit();
+    contracted_.clear();
+    contracted_.shrink_to_fit();
+    witness_weights_.clear();
+    witness_weights_.shrink_to_fit();
+    witness_touched_.clear();
+    witness_touched_.shrink_to_fit();
+    witness_targets_.clear();
+    witness_targets_.shrink_to_fit();
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildSearchGraph() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    const size_t edge_count = graph_.GetEdgeCount() + shortcuts_.size();
+
+    up_offsets_.assign(vertex_count + 1, 0);
+    down_offsets_.assign(vertex_count + 1, 0);
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        if (edge_id < graph_.GetEdgeCount() && !graph_.HasEdge(edge_id)) {
+            continue;  // removed edge
+        }
+        const VertexId from = GetFrom(edge_id);
+        const VertexId to = GetTo(edge_id);
+        if (ranks_[from] < ranks_[to]) {
+            ++up_offsets_[from + 1];
+        } else if (ranks_[from] > ranks_[to]) {
+            ++down_offsets_[to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        up_offsets_[vertex + 1] += up_offsets_[vertex];
+        down_offsets_[vertex + 1] += down_offsets_[vertex];
+    }
+
+    up_arcs_.resize(up_offsets_.back());
+    down_arcs_.resize(down_offsets_.back());
+    std::vector<size_t> up_pos(up_offsets_.begin(), up_offsets_.end() - 1);
+    std::vector<size_t> down_pos(down_offsets_.begin(), down_offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        if (edge_id < graph_.GetEdgeCount() && !graph_.HasEdge(edge_id)) {
+            continue;  // removed edge
+        }
+        const VertexId from = GetFrom(edge_id);
+        const VertexId to = GetTo(edge_id);
+        if (ranks_[from] < ranks_[to]) {
+            up_arcs_[up_pos[from]++] = {to, GetWeight(edge_id), edge_id};
+        } else if (ranks_[from] > ranks_[to]) {
+            down_arcs_[down_pos[to]++] = {from, GetWeight(edge_id), edge_id};
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack{edge_id};
+    while (!stack.empty()) {
+        const EdgeId current = stack.back();
+        stack.pop_back();
+        if (current < graph_.GetEdgeCount()) {
+            edges.push_back(current);
+        } else {
+            const auto& shortcut = shortcuts_[current - graph_.GetEdgeCount()];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    // search spaces are reused by the queries of the thread
+    thread_local SearchSpace forward;
+    thread_local SearchSpace backward;
+    for (SearchSpace* space : {&forward, &backward}) {
+        for (const VertexId vertex : space->touched) {
+            space->weights[vertex] = MAX_WEIGHT;
+        }
+        space->touched.clear();
+        if (space->weights.size() != vertex_count) {
+            space->weights.assign(vertex_count, MAX_WEIGHT);
+            space->edges.assign(vertex_count, NO_EDGE);
+        }
+    }
+
+    Queue forward_queue;
+    Queue backward_queue;
+    auto start = [](SearchSpace& space, Queue& queue, VertexId vertex) {
+        space.weights[vertex] = ZERO_WEIGHT;
+        space.edges[vertex] = NO_EDGE;
+        space.touched.push_back(vertex);
+        queue.push({ZERO_WEIGHT, vertex});
+    };
+    start(forward, forward_queue, from);
+    start(backward, backward_queue, to);
+
+    Weight best_weight = MAX_WEIGHT;
+    VertexId meeting = vertex_count;
+
+    auto step = [&](SearchSpace& space, Queue& queue, const SearchSpace& other,
+                    const std::vector<size_t>& offsets, const std::vector<Arc>& arcs) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > space.weights[vertex]) {
+            return;
+        }
+        if (other.weights[vertex] != MAX_WEIGHT && weight + other.weights[vertex] < best_weight) {
+            best_weight = weight + other.weights[vertex];
+            meeting = vertex;
+        }
+        for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+            const Arc& arc = arcs[i];
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < space.weights[arc.to]) {
+                if (space.weights[arc.to] == MAX_WEIGHT) {
+                    space.touched.push_back(arc.to);
+                }
+                space.weights[arc.to] = candidate_weight;
+                space.edges[arc.to] = arc.edge_id;
+                queue.push({candidate_weight, arc.to});
+            }
+        }
+    };
+
+    // each direction stops when its queue can't improve the best meeting
+    while (true) {
+        const bool forward_active = !forward_queue.empty() && forward_queue.top().first < best_weight;
+        const bool backward_active = !backward_queue.empty() && backward_queue.top().first < best_weight;
+        if (!forward_active && !backward_active) {
+            break;
+        }
+        if (forward_active && (!backward_active || forward_queue.top().first <= backward_queue.top().first)) {
+            step(forward, forward_queue, backward, up_offsets_, up_arcs_);
+        } else {
+            step(backward, backward_queue, forward, down_offsets_, down_arcs_);
+        }
+    }
+
+    if (meeting == vertex_count) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> forward_edges;
+    for (VertexId vertex = meeting; forward.edges[vertex] != NO_EDGE; vertex = GetFrom(forward.edges[vertex])) {
+        forward_edges.push_back(forward.edges[vertex]);
+    }
+    std::vector<EdgeId> edges;
+    for (auto it = forward_edges.rbegin(); it != forward_edges.rend(); ++it) {
+        UnpackEdge(*it, edges);
+    }
+    for (VertexId vertex = meeting; backward.edges[vertex] != NO_EDGE; vertex = GetTo(backward.edges[vertex])) {
+        UnpackEdge(backward.edges[vertex], edges);
+    }
+
+    return RouteInfo{best_weight, std::move(edges)};
+}
+
+}  // namespace graph
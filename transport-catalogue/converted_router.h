@@ -0,0 +1,135 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// engine of the given kind over the graph, the weight type comes from the graph
+template <template <typename> typename Engine, typename Weight, typename... Args>
+std::unique_ptr<RouterEngine<Weight>> MakeEngine(const DirectedWeightedGraph<Weight>& graph, Args&&... args) {
+    return std::make_unique<Engine<Weight>>(graph, std::forward<Args>(args)...);
+}
+
+// Engine with other weights (f.e. float or fixed-point table) behind the double interface.
+// It keeps a copy of the graph with converted weights, edge ids are the same.
+// Route weights are summed back in double over the route's edges of the source graph,
+// so only the choice of the route depends on the precision of Weight
+template <typename Weight>
+class ConvertedRouter final : public RouterEngine<double> {
+
+private:
+    using SourceGraph = DirectedWeightedGraph<double>;
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using ToWeight = std::function<Weight(double)>;
+    using FromWeight = std::function<double(Weight)>;
+    using MakeTable = std::function<std::unique_ptr<RouterEngine<Weight>>(const Graph&)>;
+
+    // source graph should be frozen, make_table builds the engine over the converted copy
+    ConvertedRouter(const SourceGraph& source_graph, ToWeight to_weight, FromWeight from_weight,
+                    const MakeTable& make_table);
+
+    std::optional<RouteInfo<double>> BuildRoute(VertexId from, VertexId to) const override;
+
+    std::optional<double> AppendRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const override;
+
+    std::vector<std::optional<double>> BuildWeights(VertexId from, const std::vector<VertexId>& to) const override;
+
+    // the copy is converted again, then the engine follows the same edges
+    bool Update(const std::vector<EdgeId>& changed_edges) override;
+
+    const RouterEngine<Weight>& GetEngine() const {
+        return *engine_;
+    }
+
+private:
+    void ConvertGraph();
+
+    const SourceGraph& source_graph_;
+    ToWeight to_weight_;
+    FromWeight from_weight_;
+    Graph graph_;
+    std::unique_ptr<RouterEngine<Weight>> engine_;
+};
+
+template <typename Weight>
+ConvertedRouter<Weight>::ConvertedRouter(const SourceGraph& source_graph, ToWeight to_weight,
+                                         FromWeight from_weight, const MakeTable& make_table)
+    : source_graph_(source_graph)
+    , to_weight_(std::move(to_weight))
+    , from_weight_(std::move(from_weight))
+{
+    if (!source_graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    ConvertGraph();
+    engine_ = make_table(graph_);
+}
+
+template <typename Weight>
+void ConvertedRouter<Weight>::ConvertGraph() {
+    // same object, the engine keeps a reference to it
+    graph_ = Graph(source_graph_.GetVertexCount());
+    for (EdgeId edge_id = 0; edge_id < source_graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = source_graph_.GetEdge(edge_id);
+        graph_.AddEdge({edge.from, edge.to, to_weight_(edge.weight)});
+    }
+    for (EdgeId edge_id = 0; edge_id < source_graph_.GetEdgeCount(); ++edge_id) {
+        if (!source_graph_.HasEdge(edge_id)) {
+            graph_.RemoveEdge(edge_id);
+        }
+    }
+    graph_.Freeze();
+}
+
+template <typename Weight>
+std::optional<double> ConvertedRouter<Weight>::AppendRoute(VertexId from, VertexId to,
+                                                           std::vector<EdgeId>& edges) const {
+    const size_t first = edges.size();
+    if (!engine_->AppendRoute(from, to, edges)) {
+        return std::nullopt;
+    }
+    double weight = 0.0;
+    for (size_t i = first; i < edges.size(); ++i) {
+        weight += source_graph_.GetEdge(edges[i]).weight;
+    }
+    return weight;
+}
+
+template <typename Weight>
+std::optional<RouteInfo<double>> ConvertedRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    std::vector<EdgeId> edges;
+    const auto weight = AppendRoute(from, to, edges);
+    if (!weight) {
+        return std::nullopt;
+    }
+    return RouteInfo<double>{*weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<std::optional<double>> ConvertedRouter<Weight>::BuildWeights(VertexId from,
+                                                                         const std::vector<VertexId>& to) const {
+    std::vector<std::optional<double>> weights;
+    weights.reserve(to.size());
+    for (const auto& weight : engine_->BuildWeights(from, to)) {
+        weights.push_back(weight ? std::optional<double>(from_weight_(*weight)) : std::nullopt);
+    }
+    return weights;
+}
+
+template <typename Weight>
+bool ConvertedRouter<Weight>::Update(const std::vector<EdgeId>& changed_edges) {
+    ConvertGraph();
+    return engine_->Update(changed_edges);
+}
+
+}  // namespace graph
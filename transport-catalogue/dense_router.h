@@ -0,0 +1,234 @@
+#pragma once
+
+#include "floyd_warshall.h"
+#include "graph.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+#include "thread_pool.h"
+#include "weight_traits.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace transport {
+    struct Serial;
+}
+
+namespace graph {
+
+// All-pairs engine with the same Floyd–Warshall as Router, but the table is flat:
+// row-major weights (UNREACHABLE for no route) and uint32 prev edges (NO_EDGE for none).
+// Weight is double, float or a fixed-point uint32, see WeightTraits
+template <typename Weight>
+class DenseRouter final : public RouterEngine<Weight> {
+
+    friend class transport::Serial;
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using PrevEdge = uint32_t;
+
+    static constexpr Weight UNREACHABLE = WeightTraits<Weight>::UNREACHABLE;
+    static constexpr PrevEdge NO_EDGE = std::numeric_limits<PrevEdge>::max();
+
+    // thread_count != 1 - tiled Floyd–Warshall on the pool (0 - all cores), same table
+    explicit DenseRouter(const Graph& graph, size_t thread_count = 1);
+
+    // restores computed table (f.e. from the base file)
+    DenseRouter(const Graph& graph, std::vector<Weight> weights, std::vector<PrevEdge> prev_edges);
+
+    // table in external memory which outlives the router (f.e. a mapped base file), read in place;
+    // Update() copies it first
+    DenseRouter(const Graph& graph, const Weight* weights, const PrevEdge* prev_edges);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    std::optional<Weight> AppendRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const override;
+
+    std::vector<std::optional<Weight>> BuildWeights(VertexId from, const std::vector<VertexId>& to) const override;
+
+    // rows which may change are computed again by Dijkstra, the others stay
+    bool Update(const std::vector<EdgeId>& changed_edges) override;
+
+private:
+    // copies an external table into weights_ and prev_edges_
+    void OwnTable();
+
+    size_t Cell(VertexId from, VertexId to) const {
+        return from * vertex_count_ + to;
+    }
+
+    void InitializeRoutesInternalData(const Graph& graph) {
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[Cell(vertex, vertex)] = ZERO_WEIGHT;
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                if (edge.weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const size_t cell = Cell(vertex, edge.to);
+                if (weights_[cell] == UNREACHABLE || weights_[cell] > edge.weight) {
+                    weights_[cell] = edge.weight;
+                    prev_edges_[cell] = static_cast<PrevEdge>(edge_id);
+                }
+            }
+        }
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    size_t vertex_count_;
+    std::vector<Weight> weights_;
+    std::vector<PrevEdge> prev_edges_;
+    // the table for reading: data of the vectors above or the external one
+    const Weight* weights_data_ = nullptr;
+    const PrevEdge* prev_edges_data_ = nullptr;
+};
+
+template <typename Weight>
+DenseRouter<Weight>::DenseRouter(const Graph& graph, size_t thread_count)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, UNREACHABLE)
+    , prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
+{
+    if (graph.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for 32-bit edge ids");
+    }
+    InitializeRoutesInternalData(graph);
+
+    FloydWarshall<Weight, PrevEdge> floyd_warshall(vertex_count_, weights_.data(), prev_edges_.data(), NO_EDGE);
+    if (thread_count == 1) {
+        floyd_warshall.Run();
+    } else {
+        concurrency::ThreadPool pool(thread_count);
+        floyd_warshall.Run(pool);
+    }
+    weights_data_ = weights_.data();
+    prev_edges_data_ = prev_edges_.data();
+}
+
+template <typename Weight>
+DenseRouter<Weight>::DenseRouter(const Graph& graph, std::vector<Weight> weights,
+                                 std::vector<PrevEdge> prev_edges)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , weights_(std::move(weights))
+    , prev_edges_(std::move(prev_edges))
+{
+    if (weights_.size() != vertex_count_ * vertex_count_ || prev_edges_.size() != weights_.size()) {
+        throw std::invalid_argument("Routes table doesn't match the graph");
+    }
+    weights_data_ = weights_.data();
+    prev_edges_data_ = prev_edges_.data();
+}
+
+template <typename Weight>
+DenseRouter<Weight>::DenseRouter(const Graph& graph, const Weight* weights, const PrevEdge* prev_edges)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , weights_data_(weights)
+    , prev_edges_data_(prev_edges)
+{
+}
+
+template <typename Weight>
+void DenseRouter<Weight>::OwnTable() {
+    if (weights_data_ == weights_.data()) {
+        return;
+    }
+    const size_t cell_count = vertex_count_ * vertex_count_;
+    weights_.assign(weights_data_, weights_data_ + cell_count);
+    prev_edges_.assign(prev_edges_data_, prev_edges_data_ + cell_count);
+    weights_data_ = weights_.data();
+    prev_edges_data_ = prev_edges_.data();
+}
+
+template <typename Weight>
+std::optional<Weight> DenseRouter<Weight>::AppendRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const Weight weight = weights_data_[Cell(from, to)];
+    if (weight == UNREACHABLE) {
+        return std::nullopt;
+    }
+    const PrevEdge* row_prev_edges = &prev_edges_data_[Cell(from, 0)];
+    const size_t first = edges.size();
+    for (PrevEdge edge_id = row_prev_edges[to];
+         edge_id != NO_EDGE;
+         edge_id = row_prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin() + first, edges.end());
+
+    return weight;
+}
+
+template <typename Weight>
+std::optional<typename DenseRouter<Weight>::RouteInfo> DenseRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    std::vector<EdgeId> edges;
+    const auto weight = AppendRoute(from, to, edges);
+    if (!weight) {
+        return std::nullopt;
+    }
+    return RouteInfo{*weight, std::move(edges)};
+}
+
+template <typename Weight>
+bool DenseRouter<Weight>::Update(const std::vector<EdgeId>& changed_edges) {
+    if (graph_.GetVertexCount() != vertex_count_ || graph_.GetEdgeCount() >= NO_EDGE) {
+        return false;
+    }
+    OwnTable();
+    for (VertexId from = 0; from < vertex_count_; ++from) {
+        const Weight* row_weights = &weights_[Cell(from, 0)];
+        const PrevEdge* row_prev_edges = &prev_edges_[Cell(from, 0)];
+        const bool is_affected = IsTreeAffected(graph_, changed_edges,
+            [row_weights](VertexId to) {
+                return row_weights[to] == UNREACHABLE ? std::nullopt : std::optional<Weight>(row_weights[to]);
+            },
+            [row_prev_edges](VertexId to) {
+                return row_prev_edges[to] == NO_EDGE ? std::nullopt : std::optional<EdgeId>(row_prev_edges[to]);
+            });
+        if (!is_affected) {
+            continue;
+        }
+        const auto tree = BuildShortestPathTree(graph_, from);
+        for (VertexId to = 0; to < vertex_count_; ++to) {
+            const size_t cell = Cell(from, to);
+            weights_[cell] = tree.weights[to].value_or(UNREACHABLE);
+            prev_edges_[cell] = tree.prev_edges[to] == ShortestPathTree<Weight>::NO_EDGE ?
+                                NO_EDGE : static_cast<PrevEdge>(tree.prev_edges[to]);
+        }
+    }
+    return true;
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> DenseRouter<Weight>::BuildWeights(VertexId from,
+                                                                     const std::vector<VertexId>& to) const {
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(to.size());
+    for (const VertexId vertex : to) {
+        if (from >= vertex_count_ || vertex >= vertex_count_) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const Weight weight = weights_data_[Cell(from, vertex)];
+        weights.push_back(weight == UNREACHABLE ? std::nullopt : std::optional<Weight>(weight));
+    }
+    return weights;
+}
+
+}  // namespace graph
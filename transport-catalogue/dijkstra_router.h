@@ -0,0 +1,294 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// counters of the searches, settled vertices show how much a search is pruned
+struct SearchStats {
+    size_t searches = 0;
+    size_t settled_vertices = 0;
+    size_t max_settled_vertices = 0;
+};
+
+// search counters shared by const queries
+class SearchCounters {
+public:
+    void Add(size_t settled_vertices) {
+        ++searches_;
+        settled_vertices_ += settled_vertices;
+        for (size_t max = max_settled_vertices_; max < settled_vertices
+             && !max_settled_vertices_.compare_exchange_weak(max, settled_vertices); ) {
+        }
+    }
+
+    SearchStats Get() const {
+        return {searches_, settled_vertices_, max_settled_vertices_};
+    }
+
+private:
+    std::atomic<size_t> searches_{0};
+    std::atomic<size_t> settled_vertices_{0};
+    std::atomic<size_t> max_settled_vertices_{0};
+};
+
+// counters of the shortest-path tree cache
+struct TreeCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t trees = 0;       // trees in the cache now
+    size_t capacity = 0;    // trees within the memory budget
+    size_t invalidations = 0;  // trees dropped after graph edits
+};
+
+// Bounded one-to-all search over a frozen graph: vertices with route weight <= max_weight
+// in the order they are settled, vertices beyond the budget are never queued
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> FindReachable(const DirectedWeightedGraph<Weight>& graph,
+                                                       VertexId from, Weight max_weight) {
+    ShortestPathTree<Weight> tree;
+    std::vector<std::pair<VertexId, Weight>> reachable;
+    SearchShortestPathTree(graph, from, tree, [&reachable](VertexId vertex, Weight weight) {
+        reachable.push_back({vertex, weight});
+        return SettleAction::RELAX;
+    }, std::optional<Weight>(max_weight));
+    return reachable;
+}
+
+// On-demand engine: single-source Dijkstra with a binary heap for every query.
+// Keeps only the reference to the frozen graph, memory per query is O(V).
+// With a cache budget complete trees of recent sources are kept in LRU order,
+// a repeated source costs only the path reconstruction
+template <typename Weight>
+class DijkstraRouter final : public RouterEngine<Weight> {
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit DijkstraRouter(const Graph& graph, size_t cache_bytes = 0);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // one search (or one cached tree) for all targets
+    std::vector<std::optional<Weight>> BuildWeights(VertexId from, const std::vector<VertexId>& to) const override;
+
+    // searches read the graph, only cached trees which may change are dropped
+    bool Update(const std::vector<EdgeId>& changed_edges) override;
+
+    TreeCacheStats GetCacheStats() const;
+
+    SearchStats GetSearchStats() const {
+        return search_counters_.Get();
+    }
+
+private:
+    using Tree = ShortestPathTree<Weight>;
+
+    struct CachedTree {
+        std::shared_ptr<const Tree> tree;
+        typename std::list<VertexId>::iterator recent_it;
+    };
+
+    // stops when all targets are settled, no targets - complete tree
+    Tree Search(VertexId from, const VertexId* targets, size_t target_count) const;
+
+    std::shared_ptr<const Tree> GetTree(VertexId from) const;
+
+    std::optional<RouteInfo> MakeRoute(const Tree& tree, VertexId to) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = Tree::NO_EDGE;
+    const Graph& graph_;
+    size_t cache_capacity_ = 0;
+
+    // BuildRoute is const and may run in parallel, the cache is under the mutex
+    mutable std::mutex cache_mutex_;
+    mutable std::list<VertexId> recent_sources_;  // most recent first
+    mutable std::unordered_map<VertexId, CachedTree> trees_;
+    mutable TreeCacheStats stats_;
+    mutable SearchCounters search_counters_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t cache_bytes)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    const size_t tree_bytes = std::max<size_t>(1, graph.GetVertexCount())
+                              * (sizeof(std::optional<Weight>) + sizeof(EdgeId));
+    cache_capacity_ = cache_bytes / tree_bytes;
+    stats_.capacity = cache_capacity_;
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo>
+DijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (cache_capacity_ == 0) {
+        return MakeRoute(Search(from, &to, 1), to);
+    }
+    return MakeRoute(*GetTree(from), to);
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> DijkstraRouter<Weight>::BuildWeights(VertexId from,
+                                                                        const std::vector<VertexId>& to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || std::any_of(to.begin(), to.end(), [vertex_count](VertexId vertex) {
+            return vertex >= vertex_count;
+        }))
+    {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::shared_ptr<const Tree> tree;
+    if (cache_capacity_ == 0) {
+        tree = std::make_shared<const Tree>(Search(from, to.data(), to.size()));
+    } else {
+        tree = GetTree(from);
+    }
+
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(to.size());
+    for (const VertexId vertex : to) {
+        weights.push_back(tree->weights[vertex]);
+    }
+    return weights;
+}
+
+template <typename Weight>
+bool DijkstraRouter<Weight>::Update(const std::vector<EdgeId>& changed_edges) {
+    std::lock_guard lock(cache_mutex_);
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (auto it = recent_sources_.begin(); it != recent_sources_.end(); ) {
+        const Tree& tree = *trees_.at(*it).tree;
+        const bool is_affected = tree.weights.size() != vertex_count
+            || IsTreeAffected(graph_, changed_edges,
+                              [&tree](VertexId to) { return tree.weights[to]; },
+                              [&tree](VertexId to) {
+                                  return tree.prev_edges[to] == NO_EDGE ? std::nullopt
+                                                                        : std::optional<EdgeId>(tree.prev_edges[to]);
+                              });
+        if (is_affected) {
+            trees_.erase(*it);
+            it = recent_sources_.erase(it);
+            ++stats_.invalidations;
+        } else {
+            ++it;
+        }
+    }
+    stats_.trees = trees_.size();
+    return true;
+}
+
+template <typename Weight>
+TreeCacheStats DijkstraRouter<Weight>::GetCacheStats() const {
+    std::lock_guard lock(cache_mutex_);
+    return stats_;
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::Tree DijkstraRouter<Weight>::Search(VertexId from, const VertexId* targets,
+                                                                     size_t target_count) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    // a single target is compared directly, many are marked
+    size_t remaining_targets = target_count;
+    std::vector<bool> is_target;
+    if (target_count > 1) {
+        is_target.assign(vertex_count, false);
+        for (size_t i = 0; i < target_count; ++i) {
+            if (is_target[targets[i]]) {
+                --remaining_targets;
+            }
+            is_target[targets[i]] = true;
+        }
+    }
+
+    Tree tree;
+    const size_t settled_count = SearchShortestPathTree(graph_, from, tree, [&](VertexId vertex, Weight) {
+        const bool is_settled_target = target_count == 1 ? vertex == *targets
+                                                         : target_count > 1 && is_target[vertex];
+        return is_settled_target && --remaining_targets == 0 ? SettleAction::STOP : SettleAction::RELAX;
+    });
+    search_counters_.Add(settled_count);
+    return tree;
+}
+
+template <typename Weight>
+std::shared_ptr<const typename DijkstraRouter<Weight>::Tree> DijkstraRouter<Weight>::GetTree(VertexId from) const {
+    {
+        std::lock_guard lock(cache_mutex_);
+        if (const auto it = trees_.find(from); it != trees_.end()) {
+            ++stats_.hits;
+            recent_sources_.splice(recent_sources_.begin(), recent_sources_, it->second.recent_it);
+            return it->second.tree;
+        }
+        ++stats_.misses;
+    }
+
+    // the search runs without the lock, a parallel miss on the same source keeps the first tree
+    auto tree = std::make_shared<const Tree>(Search(from, nullptr, 0));
+
+    std::lock_guard lock(cache_mutex_);
+    if (const auto it = trees_.find(from); it != trees_.end()) {
+        return it->second.tree;
+    }
+    recent_sources_.push_front(from);
+    trees_.emplace(from, CachedTree{tree, recent_sources_.begin()});
+    while (trees_.size() > cache_capacity_) {
+        trees_.erase(recent_sources_.back());
+        recent_sources_.pop_back();
+        ++stats_.evictions;
+    }
+    stats_.trees = trees_.size();
+    return tree;
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo>
+DijkstraRouter<Weight>::MakeRoute(const Tree& tree, VertexId to) const {
+    if (!tree.weights[to]) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = tree.prev_edges[to]; edge_id != NO_EDGE;
+         edge_id = tree.prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{*tree.weights[to], std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "graph.h"
+#include "min_plus.h"
+#include "thread_pool.h"
+#include "weight_traits.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace graph {
+
+// Floyd–Warshall over a flat row-major table: weights (WeightTraits::UNREACHABLE for no route) and prev edges
+// (no_edge for none). Both variants give every cell the same candidates in the same order
+// as the classic k-i-j loop, so the results are equal bit by bit
+template <typename Weight, typename PrevEdge>
+class FloydWarshall {
+public:
+    static constexpr Weight UNREACHABLE = WeightTraits<Weight>::UNREACHABLE;
+    // tile side, 64 x 64 cells of double + uint32 fit in L1/L2
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    FloydWarshall(size_t vertex_count, Weight* weights, PrevEdge* prev_edges, PrevEdge no_edge)
+        : vertex_count_(vertex_count)
+        , weights_(weights)
+        , prev_edges_(prev_edges)
+        , no_edge_(no_edge)
+        , relax_row_(SelectRelaxRow<Weight, PrevEdge>()) {
+    }
+
+    // classic loop, one thread
+    void Run();
+
+    // tiled loop: for every block of through vertices the diagonal tile goes first,
+    // then the tiles of its row and column, then all other tiles.
+    // Tiles of the last two phases are independent and are spread over the pool
+    void Run(concurrency::ThreadPool& pool);
+
+private:
+    // d[from][k] and d[k][to] don't change while relaxing through k (d[k][k] == 0),
+    // the tiled loop keeps them for the whole block in the column and row panels
+    void SnapshotRow(VertexId vertex_through, size_t through_index, VertexId to_begin, VertexId to_end) {
+        const size_t cell = vertex_through * vertex_count_;
+        const size_t panel = through_index * vertex_count_;
+        std::copy(weights_ + cell + to_begin, weights_ + cell + to_end, row_weights_.data() + panel + to_begin);
+        std::copy(prev_edges_ + cell + to_begin, prev_edges_ + cell + to_end,
+                  row_prev_edges_.data() + panel + to_begin);
+    }
+
+    void SnapshotColumn(VertexId vertex_through, size_t through_index, VertexId from_begin, VertexId from_end) {
+        for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+            const size_t cell = vertex_from * vertex_count_ + vertex_through;
+            column_weights_[vertex_from * BLOCK_SIZE + through_index] = weights_[cell];
+            column_prev_edges_[vertex_from * BLOCK_SIZE + through_index] = prev_edges_[cell];
+        }
+    }
+
+    void RelaxRow(VertexId vertex_from, Weight weight_from, PrevEdge prev_edge_from,
+                  const Weight* through_weights, const PrevEdge* through_prev_edges,
+                  VertexId to_begin, VertexId to_end) {
+        const size_t row = vertex_from * vertex_count_;
+        relax_row_(weight_from, prev_edge_from, through_weights + to_begin, through_prev_edges + to_begin,
+                   weights_ + row + to_begin, prev_edges_ + row + to_begin, to_end - to_begin, no_edge_);
+    }
+
+    void RelaxRowFromPanels(VertexId vertex_from, size_t through_index, VertexId to_begin, VertexId to_end) {
+        const size_t column_cell = vertex_from * BLOCK_SIZE + through_index;
+        const Weight weight_from = column_weights_[column_cell];
+        if (weight_from == UNREACHABLE) {
+            return;
+        }
+        RelaxRow(vertex_from, weight_from, column_prev_edges_[column_cell],
+                 row_weights_.data() + through_index * vertex_count_,
+                 row_prev_edges_.data() + through_index * vertex_count_, to_begin, to_end);
+    }
+
+    VertexId BlockBegin(size_t block) const {
+        return block * BLOCK_SIZE;
+    }
+
+    VertexId BlockEnd(size_t block) const {
+        return std::min(vertex_count_, (block + 1) * BLOCK_SIZE);
+    }
+
+    // diagonal, row and column tiles: panels are filled step by step
+    void RelaxPanelTile(size_t block_through, size_t block_from, size_t block_to);
+
+    // other tiles: every through vertex of the block is already in the panels
+    void RelaxInnerTile(size_t block_through, size_t block_from, size_t block_to);
+
+    size_t vertex_count_;
+    Weight* weights_;
+    PrevEdge* prev_edges_;
+    PrevEdge no_edge_;
+    // vector kernel for this CPU or the scalar loop
+    RelaxRowFunction<Weight, PrevEdge> relax_row_;
+
+    // column panel: vertex_count x BLOCK_SIZE, row panel: BLOCK_SIZE x vertex_count
+    std::vector<Weight> column_weights_;
+    std::vector<PrevEdge> column_prev_edges_;
+    std::vector<Weight> row_weights_;
+    std::vector<PrevEdge> row_prev_edges_;
+};
+
+template <typename Weight, typename PrevEdge>
+void FloydWarshall<Weight, PrevEdge>::Run() {
+    for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+        const Weight* through_weights = weights_ + vertex_through * vertex_count_;
+        const PrevEdge* through_prev_edges = prev_edges_ + vertex_through * vertex_count_;
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            const size_t cell = vertex_from * vertex_count_ + vertex_through;
+            if (weights_[cell] == UNREACHABLE) {
+                continue;
+            }
+            RelaxRow(vertex_from, weights_[cell], prev_edges_[cell], through_weights, through_prev_edges,
+                     0, vertex_count_);
+        }
+    }
+}
+
+template <typename Weight, typename PrevEdge>
+void FloydWarshall<Weight, PrevEdge>::Run(concurrency::ThreadPool& pool) {
+    const size_t block_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    column_weights_.assign(vertex_count_ * BLOCK_SIZE, UNREACHABLE);
+    column_prev_edges_.assign(vertex_count_ * BLOCK_SIZE, no_edge_);
+    row_weights_.assign(BLOCK_SIZE * vertex_count_, UNREACHABLE);
+    row_prev_edges_.assign(BLOCK_SIZE * vertex_count_, no_edge_);
+
+    for (size_t block_through = 0; block_through < block_count; ++block_through) {
+        RelaxPanelTile(block_through, block_through, block_through);
+
+        // row tiles go first in the task list, then column tiles
+        pool.ParallelFor(2 * (block_count - 1), [&](size_t task) {
+            size_t block = task % (block_count - 1);
+            block += block >= block_through ? 1 : 0;
+            if (task < block_count - 1) {
+                RelaxPanelTile(block_through, block_through, block);
+            } else {
+                RelaxPanelTile(block_through, block, block_through);
+            }
+        });
+
+        pool.ParallelFor((block_count - 1) * (block_count - 1), [&](size_t task) {
+            size_t block_from = task / (block_count - 1);
+            size_t block_to = task % (block_count - 1);
+            block_from += block_from >= block_through ? 1 : 0;
+            block_to += block_to >= block_through ? 1 : 0;
+            RelaxInnerTile(block_through, block_from, block_to);
+        });
+    }
+}
+
+template <typename Weight, typename PrevEdge>
+void FloydWarshall<Weight, PrevEdge>::RelaxPanelTile(size_t block_through, size_t block_from,
+                                                     size_t block_to) {
+    const VertexId through_begin = BlockBegin(block_through);
+    const VertexId through_end = BlockEnd(block_through);
+    const VertexId from_begin = BlockBegin(block_from);
+    const VertexId from_end = BlockEnd(block_from);
+    const VertexId to_begin = BlockBegin(block_to);
+    const VertexId to_end = BlockEnd(block_to);
+
+    for (VertexId vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+        const size_t through_index = vertex_through - through_begin;
+        if (block_from == block_through) {
+            SnapshotRow(vertex_through, through_index, to_begin, to_end);
+        }
+        if (block_to == block_through) {
+            SnapshotColumn(vertex_through, through_index, from_begin, from_end);
+        }
+        for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+            RelaxRowFromPanels(vertex_from, through_index, to_begin, to_end);
+        }
+    }
+}
+
+template <typename Weight, typename PrevEdge>
+void FloydWarshall<Weight, PrevEdge>::RelaxInnerTile(size_t block_through, size_t block_from,
+                                                     size_t block_to) {
+    const size_t through_count = BlockEnd(block_through) - BlockBegin(block_through);
+    const VertexId to_begin = BlockBegin(block_to);
+    const VertexId to_end = BlockEnd(block_to);
+
+    // cells of the tile don't feed each other here, so a row takes all through vertices at once
+    for (VertexId vertex_from = BlockBegin(block_from); vertex_from < BlockEnd(block_from); ++vertex_from) {
+        for (size_t through_index = 0; through_index < through_count; ++through_index) {
+            RelaxRowFromPanels(vertex_from, through_index, to_begin, to_end);
+        }
+    }
+}
+
+}  // namespace graph
@@ -1,9 +1,10 @@
 #pragma once
 
 #include "ranges.h"
-#include "serialization.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
 namespace transport {
@@ -22,6 +23,13 @@ struct Edge {
     Weight weight;
 };
 
+// edge in the CSR arrays of a frozen graph, `from` is the vertex of the row
+template <typename Weight>
+struct AdjacentEdge {
+    VertexId to;
+    Weight weight;
+};
+
 template <typename Weight>
 class DirectedWeightedGraph {
 
@@ -30,6 +38,8 @@ class DirectedWeightedGraph {
 private:
     using IncidenceList = std::vector<EdgeId>;
     using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using AdjacentEdges = std::vector<AdjacentEdge<Weight>>;
+    using AdjacentEdgesRange = ranges::Range<typename AdjacentEdges::const_iterator>;
 
 public:
     DirectedWeightedGraph() = default;
@@ -41,9 +51,30 @@ public:
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+    // packs the incidence lists into CSR arrays sorted by source, edge ids and their
+    // order within a vertex stay the same, no edges can be added after it
+    void Freeze();
+    bool IsFrozen() const;
+    // frozen graph only, goes in parallel with GetIncidentEdges(vertex)
+    AdjacentEdgesRange GetAdjacentEdges(VertexId vertex) const;
+
+    // edits of a filled graph: Thaw(), changes, Freeze(), all in O(V + E).
+    // A removed edge keeps its id and GetEdge(), but is not incident to any vertex
+    void Thaw();
+    VertexId AddVertex();
+    void SetEdgeWeight(EdgeId edge_id, Weight weight);
+    void RemoveEdge(EdgeId edge_id);
+    bool HasEdge(EdgeId edge_id) const;
+
 private:
     std::vector<Edge<Weight>> edges_;
+    std::vector<bool> is_removed_;
     std::vector<IncidenceList> incidence_lists_;
+
+    // CSR: edges of vertex v are [offsets_[v], offsets_[v + 1])
+    std::vector<size_t> offsets_;
+    IncidenceList incident_edges_;
+    AdjacentEdges adjacent_edges_;
 };
 
 template <typename Weight>
@@ -53,7 +84,11 @@ DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (IsFrozen()) {
+        throw std::logic_error("Graph is frozen");
+    }
     edges_.push_back(edge);
+    is_removed_.push_back(false);
     const EdgeId id = edges_.size() - 1;
     incidence_lists_.at(edge.from).push_back(id);
     return id;
@@ -61,7 +96,7 @@ EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return IsFrozen() ? offsets_.size() - 1 : incidence_lists_.size();
 }
 
 template <typename Weight>
@@ -77,6 +112,92 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+    if (IsFrozen()) {
+        return {incident_edges_.begin() + offsets_.at(vertex), incident_edges_.begin() + offsets_.at(vertex + 1)};
+    }
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (IsFrozen()) {
+        return;
+    }
+    offsets_.assign(incidence_lists_.size() + 1, 0);
+    incident_edges_.reserve(edges_.size());
+    adjacent_edges_.reserve(edges_.size());
+    for (VertexId vertex = 0; vertex < incidence_lists_.size(); ++vertex) {
+        for (const EdgeId edge_id : incidence_lists_[vertex]) {
+            incident_edges_.push_back(edge_id);
+            adjacent_edges_.push_back({edges_[edge_id].to, edges_[edge_id].weight});
+        }
+        offsets_[vertex + 1] = incident_edges_.size();
+    }
+    incidence_lists_.clear();
+    incidence_lists_.shrink_to_fit();
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Thaw() {
+    if (!IsFrozen()) {
+        return;
+    }
+    incidence_lists_.resize(offsets_.size() - 1);
+    for (VertexId vertex = 0; vertex < incidence_lists_.size(); ++vertex) {
+        incidence_lists_[vertex].assign(incident_edges_.begin() + offsets_[vertex],
+                                        incident_edges_.begin() + offsets_[vertex + 1]);
+    }
+    offsets_.clear();
+    incident_edges_.clear();
+    adjacent_edges_.clear();
+}
+
+template <typename Weight>
+VertexId DirectedWeightedGraph<Weight>::AddVertex() {
+    if (IsFrozen()) {
+        throw std::logic_error("Graph is frozen");
+    }
+    incidence_lists_.emplace_back();
+    return incidence_lists_.size() - 1;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::SetEdgeWeight(EdgeId edge_id, Weight weight) {
+    if (IsFrozen()) {
+        throw std::logic_error("Graph is frozen");
+    }
+    edges_.at(edge_id).weight = weight;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::RemoveEdge(EdgeId edge_id) {
+    if (IsFrozen()) {
+        throw std::logic_error("Graph is frozen");
+    }
+    if (!HasEdge(edge_id)) {
+        return;
+    }
+    auto& list = incidence_lists_.at(edges_[edge_id].from);
+    list.erase(std::find(list.begin(), list.end(), edge_id));
+    is_removed_[edge_id] = true;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::HasEdge(EdgeId edge_id) const {
+    return edge_id < edges_.size() && !is_removed_[edge_id];
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return !offsets_.empty();
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::AdjacentEdgesRange
+DirectedWeightedGraph<Weight>::GetAdjacentEdges(VertexId vertex) const {
+    if (!IsFrozen()) {
+        throw std::logic_error("Graph is not frozen");
+    }
+    return {adjacent_edges_.begin() + offsets_.at(vertex), adjacent_edges_.begin() + offsets_.at(vertex + 1)};
+}
 }  // namespace graph
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace transport {
+    struct Serial;
+}
+
+namespace graph {
+
+struct HubLabelStats {
+    size_t vertices = 0;
+    size_t out_entries = 0;  // sum of the forward label sizes
+    size_t in_entries = 0;   // sum of the backward label sizes
+    size_t max_label_size = 0;
+};
+
+// Hub labeling engine (pruned landmark labeling). Every vertex keeps a forward label -
+// hubs it reaches with route weights, and a backward label - hubs which reach it.
+// A query merges two labels sorted by hub, the route is restored by the parent edges
+// stored in the labels. Labels are built at make_base, vertices with more edges go first
+template <typename Weight>
+class HubLabeling final : public RouterEngine<Weight> {
+
+    friend class transport::Serial;
+
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    // hub is the rank of the hub vertex. Forward entry: weight of the route vertex -> hub and
+    // its first edge, backward entry: weight of the route hub -> vertex and its last edge.
+    // NO_EDGE for the hub itself
+    struct LabelEntry {
+        VertexId hub;
+        Weight weight;
+        EdgeId edge;
+    };
+
+    // labels of all vertices in one array, label of v is [offsets[v], offsets[v + 1])
+    struct Labels {
+        std::vector<size_t> offsets;
+        std::vector<LabelEntry> entries;
+    };
+
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    // preprocessing: a pruned search from every vertex in both directions, graph should be frozen
+    explicit HubLabeling(const Graph& graph);
+
+    // restores the labels (f.e. from the base file)
+    HubLabeling(const Graph& graph, Labels out_labels, Labels in_labels);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // weights only, no route restoring
+    std::vector<std::optional<Weight>> BuildWeights(VertexId from, const std::vector<VertexId>& to) const override;
+
+    HubLabelStats GetLabelStats() const;
+
+private:
+    using LabelRange = ranges::Range<typename std::vector<LabelEntry>::const_iterator>;
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    struct Arc {
+        VertexId to;
+        Weight weight;
+        EdgeId edge_id;
+    };
+
+    // forward labels get routes vertex -> hub from the backward search and vice versa
+    void Build();
+
+    // common hub with the smallest weight from -> hub -> to
+    std::optional<std::pair<Weight, VertexId>> FindHub(VertexId from, VertexId to) const;
+
+    static LabelRange GetLabel(const Labels& labels, VertexId vertex) {
+        return {labels.entries.begin() + labels.offsets.at(vertex),
+                labels.entries.begin() + labels.offsets.at(vertex + 1)};
+    }
+
+    static const LabelEntry& FindEntry(const Labels& labels, VertexId vertex, VertexId hub);
+
+    static Labels Flatten(std::vector<std::vector<LabelEntry>>& labels);
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight MAX_WEIGHT = std::numeric_limits<Weight>::max();
+    const Graph& graph_;
+    Labels out_labels_;
+    Labels in_labels_;
+};
+
+template <typename Weight>
+HubLabeling<Weight>::HubLabeling(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::invalid_argument("Graph should be frozen");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    Build();
+}
+
+template <typename Weight>
+HubLabeling<Weight>::HubLabeling(const Graph& graph, Labels out_labels, Labels in_labels)
+    : graph_(graph)
+    , out_labels_(std::move(out_labels))
+    , in_labels_(std::move(in_labels))
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    if (out_labels_.offsets.size() != vertex_count + 1 || in_labels_.offsets.size() != vertex_count + 1) {
+        throw std::invalid_argument("Labels don't match the graph");
+    }
+}
+
+template <typename Weight>
+void HubLabeling<Weight>::Build() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    // reversed arcs for the backward searches, forward ones come from the CSR
+    std::vector<size_t> in_offsets(vertex_count + 1, 0);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (const auto& edge : graph_.GetAdjacentEdges(vertex)) {
+            ++in_offsets[edge.to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        in_offsets[vertex + 1] += in_offsets[vertex];
+    }
+    std::vector<Arc> in_arcs(in_offsets.back());
+    std::vector<size_t> in_pos(in_offsets.begin(), in_offsets.end() - 1);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        auto incident_edge = graph_.GetIncidentEdges(vertex).begin();
+        for (const auto& edge : graph_.GetAdjacentEdges(vertex)) {
+            in_arcs[in_pos[edge.to]++] = {vertex, edge.weight, *incident_edge++};
+        }
+    }
+
+    std::vector<VertexId> order(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order[vertex] = vertex;
+    }
+    auto degree = [&](VertexId vertex) {
+        const auto out_edges = graph_.GetIncidentEdges(vertex);
+        return static_cast<size_t>(std::distance(out_edges.begin(), out_edges.end()))
+               + in_offsets[vertex + 1] - in_offsets[vertex];
+    };
+    std::stable_sort(order.begin(), order.end(), [&](VertexId lhs, VertexId rhs) {
+        return degree(lhs) > degree(rhs);
+    });
+
+    std::vector<std::vector<LabelEntry>> out_labels(vertex_count);
+    std::vector<std::vector<LabelEntry>> in_labels(vertex_count);
+
+    // weights between the current hub and the hubs of its own label, by hub rank
+    std::vector<Weight> hub_weights(vertex_count, MAX_WEIGHT);
+    std::vector<Weight> weights(vertex_count, MAX_WEIGHT);
+    std::vector<EdgeId> edges(vertex_count, NO_EDGE);
+    std::vector<VertexId> touched;
+
+    // forward = true: routes root -> v go to in_labels[v], otherwise routes v -> root go to out_labels[v]
+    auto search = [&](VertexId rank, VertexId root, bool forward) {
+        const auto& root_label = forward ? out_labels[root] : in_labels[root];
+        auto& labels = forward ? in_labels : out_labels;
+        for (const auto& entry : root_label) {
+            hub_weights[entry.hub] = entry.weight;
+        }
+
+        Queue queue;
+        weights[root] = ZERO_WEIGHT;
+        touched.push_back(root);
+        queue.push({ZERO_WEIGHT, root});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > weights[vertex]) {
+                continue;  // stale item
+            }
+
+            // pruned: an earlier hub already covers the route
+            bool is_covered = false;
+            for (const auto& entry : labels[vertex]) {
+                if (hub_weights[entry.hub] != MAX_WEIGHT && hub_weights[entry.hub] + entry.weight <= weight) {
+                    is_covered = true;
+                    break;
+                }
+            }
+            if (is_covered) {
+                continue;
+            }
+            labels[vertex].push_back({rank, weight, edges[vertex]});
+
+            auto relax = [&](VertexId next, Weight edge_weight, EdgeId edge_id) {
+                const Weight candidate_weight = weight + edge_weight;
+                if (candidate_weight < weights[next]) {
+                    if (weights[next] == MAX_WEIGHT) {
+                        touched.push_back(next);
+                    }
+                    weights[next] = candidate_weight;
+                    edges[next] = edge_id;
+                    queue.push({candidate_weight, next});
+                }
+            };
+            if (forward) {
+                auto incident_edge = graph_.GetIncidentEdges(vertex).begin();
+                for (const auto& edge : graph_.GetAdjacentEdges(vertex)) {
+                    relax(edge.to, edge.weight, *incident_edge++);
+                }
+            } else {
+                for (size_t i = in_offsets[vertex]; i < in_offsets[vertex + 1]; ++i) {
+                    relax(in_arcs[i].to, in_arcs[i].weight, in_arcs[i].edge_id);
+                }
+            }
+        }
+
+        for (const VertexId vertex : touched) {
+            weights[vertex] = MAX_WEIGHT;
+            edges[vertex] = NO_EDGE;
+        }
+        touched.clear();
+        for (const auto& entry : root_label) {
+            hub_weights[entry.hub] = MAX_WEIGHT;
+        }
+    };
+
+    // hubs are added in rank order, labels stay sorted by hub
+    for (VertexId rank = 0; rank < vertex_count; ++rank) {
+        search(rank, order[rank], true);
+        search(rank, order[rank], false);
+    }
+
+    out_labels_ = Flatten(out_labels);
+    in_labels_ = Flatten(in_labels);
+}
+
+template <typename Weight>
+typename HubLabeling<Weight>::Labels HubLabeling<Weight>::Flatten(std::vector<std::vector<LabelEntry>>& labels) {
+    Labels flat;
+    flat.offsets.reserve(labels.size() + 1);
+    flat.offsets.push_back(0);
+    for (auto& label : labels) {
+        flat.entries.insert(flat.entries.end(), label.begin(), label.end());
+        flat.offsets.push_back(flat.entries.size());
+        label.clear();
+        label.shrink_to_fit();
+    }
+    return flat;
+}
+
+template <typename Weight>
+const typename HubLabeling<Weight>::LabelEntry&
+HubLabeling<Weight>::FindEntry(const Labels& labels, VertexId vertex, VertexId hub) {
+    const auto label = GetLabel(labels, vertex);
+    const auto it = std::lower_bound(label.begin(), label.end(), hub,
+                                     [](const LabelEntry& entry, VertexId hub) { return entry.hub < hub; });
+    if (it == label.end() || it->hub != hub) {
+        throw std::logic_error("Broken hub labels");
+    }
+    return *it;
+}
+
+template <typename Weight>
+std::optional<std::pair<Weight, VertexId>> HubLabeling<Weight>::FindHub(VertexId from, VertexId to) const {
+    const auto out_label = GetLabel(out_labels_, from);
+    const auto in_label = GetLabel(in_labels_, to);
+
+    std::optional<std::pair<Weight, VertexId>> best;
+    auto out_it = out_label.begin();
+    auto in_it = in_label.begin();
+    while (out_it != out_label.end() && in_it != in_label.end()) {
+        if (out_it->hub < in_it->hub) {
+            ++out_it;
+        } else if (in_it->hub < out_it->hub) {
+            ++in_it;
+        } else {
+            const Weight weight = out_it->weight + in_it->weight;
+            if (!best || weight < best->first) {
+                best = {weight, out_it->hub};
+            }
+            ++out_it;
+            ++in_it;
+        }
+    }
+    return best;
+}
+
+template <typename Weight>
+std::optional<typename HubLabeling<Weight>::RouteInfo>
+HubLabeling<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    const auto hub = FindHub(from, to);
+    if (!hub) {
+        return std::nullopt;
+    }
+
+    // from -> hub by the first edges of the forward labels
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = FindEntry(out_labels_, from, hub->second).edge; edge_id != NO_EDGE;
+         edge_id = FindEntry(out_labels_, graph_.GetEdge(edge_id).to, hub->second).edge)
+    {
+        edges.push_back(edge_id);
+    }
+
+    // hub -> to by the last edges of the backward labels, collected in reverse
+    const size_t forward_size = edges.size();
+    for (EdgeId edge_id = FindEntry(in_labels_, to, hub->second).edge; edge_id != NO_EDGE;
+         edge_id = FindEntry(in_labels_, graph_.GetEdge(edge_id).from, hub->second).edge)
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin() + forward_size, edges.end());
+
+    return RouteInfo{hub->first, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> HubLabeling<Weight>::BuildWeights(VertexId from,
+                                                                      const std::vector<VertexId>& to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(to.size());
+    for (const VertexId vertex : to) {
+        if (vertex >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (vertex == from) {
+            weights.push_back(ZERO_WEIGHT);
+        } else if (const auto hub = FindHub(from, vertex)) {
+            weights.push_back(hub->first);
+        } else {
+            weights.push_back(std::nullopt);
+        }
+    }
+    return weights;
+}
+
+template <typename Weight>
+HubLabelStats HubLabeling<Weight>::GetLabelStats() const {
+    HubLabelStats stats;
+    stats.vertices = out_labels_.offsets.size() - 1;
+    stats.out_entries = out_labels_.entries.size();
+    stats.in_entries = in_labels_.entries.size();
+    for (VertexId vertex = 0; vertex < stats.vertices; ++vertex) {
+        stats.max_label_size = std::max({stats.max_label_size,
+                                         out_labels_.offsets[vertex + 1] - out_labels_.offsets[vertex],
+                                         in_labels_.offsets[vertex + 1] - in_labels_.offsets[vertex]});
+    }
+    return stats;
+}
+
+}  // namespace graph
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 #include "json_reader.h"
 #include "json_builder.h"
@@ -86,6 +87,12 @@ void JsonReader::BaseSave(transport::TransportRouter& router_) {
     auto& fname = serial_sets["file"s].AsString();
     SetRenderSettings();
     SetRouterSettings();
+    // "mapped" - sections used in place after mmap, see mapped_base.h; the loader tells them apart
+    if(const auto format_it = serial_sets.find("format"s);
+       format_it != serial_sets.end() && format_it->second.AsString() == "mapped"s) {
+        transport::Serial::SaveMappedBase(fname, catalogue_, render_rettings_, router_);
+        return;
+    }
     transport::Serial::SaveBase(fname, catalogue_, render_rettings_, router_);
 }
 
@@ -94,7 +101,18 @@ void JsonReader::BaseLoad(transport::TransportRouter& router_) {
     if(serial_sets_it == root_node_.AsDict().end()) return;
     auto& serial_sets = serial_sets_it->second.AsDict();
     auto& fname = serial_sets["file"s].AsString();
-    transport::Serial::LoadBase(fname, catalogue_, render_rettings_, router_);
+    base_ = std::make_unique<LazyBase>(fname, catalogue_, render_rettings_, router_);
+}
+
+void JsonReader::RequireRouter() {
+    if(router_required_) return;
+    router_required_ = true;
+    if(base_) base_->LoadRouter();
+    route_cache_ = RouteCache<json::Dict>(request_handler_.GetRouterSettings().route_cache_entries);
+}
+
+void JsonReader::RequireRenderSettings() {
+    if(base_) base_->LoadRenderSettings();
 }
 
 json::Dict JsonReader::ExecQueryStop(std:: string stop_name, int req_id){
@@ -148,10 +166,48 @@ json::Dict JsonReader::ExecQueryBus(std:: string bus_name, int req_id) {
     }
 }
 
+void JsonReader::ApplyUpdates() {
+    const auto& update_reqs_it = root_node_.AsDict().find("update_requests"s);
+    if(update_reqs_it == root_node_.AsDict().end()) return;
+
+    // the router follows the changes of the base catalogue
+    RequireRouter();
+
+    TransportRouter::Update update;
+    for(auto& req_node : update_reqs_it->second.AsArray()) {
+        auto& req = req_node.AsDict();
+        const auto& type = req.at("type"s).AsString();
+
+        if(type == "Distance"s) {
+            auto from = catalogue_.FindStop(req.at("from"s).AsString());
+            auto to = catalogue_.FindStop(req.at("to"s).AsString());
+            if(from == nullptr || to == nullptr) continue;
+            catalogue_.UpdateDistance(from, to, req.at("road_distance"s).AsDouble());
+            update.distances.push_back({from, to});
+        } else
+        if(type == "Bus"s) {
+            const auto& name = req.at("name"s).AsString();
+            if(catalogue_.GetBussesIndex().count(name) != 0) {
+                throw std::invalid_argument("Bus "s + name + " already exists"s);
+            }
+            FillDataBaseBuses(json::Array{req_node});
+            update.added_buses.push_back(catalogue_.GetBussesIndex().at(name));
+        } else
+        if(type == "RemoveBus"s) {
+            if(auto bus = catalogue_.RemoveBus(req.at("name"s).AsString()); bus != nullptr) {
+                update.removed_buses.push_back(bus);
+            }
+        }
+    }
+    request_handler_.UpdateRouter(update);
+}
+
 void JsonReader::ExecQueries(){
     using namespace std;
     using namespace json;
 
+    ApplyUpdates();
+
     const auto& stat_reqs_it = root_node_.AsDict().find("stat_requests"s);
     if(stat_reqs_it == root_node_.AsDict().end()) return;
     auto& stat_reqs = stat_reqs_it->second.AsArray();
@@ -180,6 +236,19 @@ void JsonReader::ExecQueries(){
             answers.push_back(ExecQueryRoute(reqs.AsDict().at("from"s).AsString(),
                                              reqs.AsDict().at("to"s).AsString(),
                                              req_id));
+        } else
+        if(type == "Matrix"s) {
+            answers.push_back(ExecQueryMatrix(reqs.AsDict().at("from"s).AsArray(),
+                                              reqs.AsDict().at("to"s).AsArray(),
+                                              req_id));
+        } else
+        if(type == "Isochrone"s) {
+            answers.push_back(ExecQueryIsochrone(reqs.AsDict().at("from"s).AsString(),
+                                                 reqs.AsDict().at("time"s).AsDouble(),
+                                                 req_id));
+        } else
+        if(type == "RouterStats"s) {
+            answers.push_back(ExecQueryRouterStats(req_id));
         }
 
     }
@@ -263,6 +332,7 @@ std::string JsonReader::RenderMap() {
     using namespace std;
     using namespace json;
 
+    RequireRenderSettings();
     SetRenderSettings();
 
     std::ostringstream ss;
@@ -280,49 +350,235 @@ bool JsonReader::SetRouterSettings() {
     TransportRouter::Settings settings;
     settings.velocity = set.at("bus_velocity"s).AsDouble();
     settings.wait = set.at("bus_wait_time"s).AsDouble();
+
+    if(const auto engine_it = set.find("routing_engine"s); engine_it != set.end()) {
+        static const std::unordered_map<std::string, TransportRouter::Engine> engines{
+            {"all_pairs"s, TransportRouter::Engine::ALL_PAIRS},
+            {"dijkstra"s, TransportRouter::Engine::DIJKSTRA},
+            {"contraction_hierarchy"s, TransportRouter::Engine::CONTRACTION_HIERARCHY},
+            {"all_pairs_dense"s, TransportRouter::Engine::ALL_PAIRS_DENSE},
+            {"raptor"s, TransportRouter::Engine::RAPTOR},
+            {"a_star"s, TransportRouter::Engine::A_STAR},
+            {"bidirectional_dijkstra"s, TransportRouter::Engine::BIDIRECTIONAL_DIJKSTRA},
+            {"hub_labeling"s, TransportRouter::Engine::HUB_LABELING},
+        };
+        settings.engine = engines.at(engine_it->second.AsString());
+    }
+    if(const auto threads_it = set.find("routing_threads"s); threads_it != set.end()) {
+        settings.threads = static_cast<size_t>(threads_it->second.AsInt());
+    }
+    if(const auto model_it = set.find("graph_model"s); model_it != set.end()) {
+        static const std::unordered_map<std::string, TransportRouter::GraphModel> models{
+            {"span_edges"s, TransportRouter::GraphModel::SPAN_EDGES},
+            {"ride_vertices"s, TransportRouter::GraphModel::RIDE_VERTICES},
+        };
+        settings.graph_model = models.at(model_it->second.AsString());
+    }
+    if(const auto cache_it = set.find("tree_cache_size_mb"s); cache_it != set.end()) {
+        settings.tree_cache_bytes = static_cast<size_t>(cache_it->second.AsDouble() * 1024 * 1024);
+    }
+    if(const auto stops_only_it = set.find("stop_vertices_only"s); stops_only_it != set.end()) {
+        settings.stop_vertices_only = stops_only_it->second.AsBool();
+    }
+    if(const auto weight_it = set.find("table_weight"s); weight_it != set.end()) {
+        static const std::unordered_map<std::string, TransportRouter::WeightType> weight_types{
+            {"double"s, TransportRouter::WeightType::DOUBLE},
+            {"float"s, TransportRouter::WeightType::FLOAT},
+            {"fixed"s, TransportRouter::WeightType::FIXED},
+        };
+        settings.weight_type = weight_types.at(weight_it->second.AsString());
+    }
+    if(const auto next_hops_it = set.find("next_hop_table"s); next_hops_it != set.end()) {
+        settings.next_hops = next_hops_it->second.AsBool();
+    }
+    if(const auto route_cache_it = set.find("route_cache_size"s); route_cache_it != set.end()) {
+        settings.route_cache_entries = static_cast<size_t>(route_cache_it->second.AsInt());
+    }
     request_handler_.InitRouter(settings);
     return true;
 }
 
-json::Node JsonReader::GetNodeValue(TransportRouter::ItemValue value) {
+json::Node JsonReader::GetRouteItem(const TransportRouter::RouteItem& item) {
     using namespace json;
-    if(std::holds_alternative<double>(value))
-        return Node(std::get<double>(value));
-    else
-    if(std::holds_alternative<int>(value))
-        return Node(std::get<int>(value));
-    else
-        return Node(std::get<std::string>(value));
+    if(item.type == TransportRouter::ItemType::WAIT) {
+        return Dict{
+            {"stop_name"s, item.stop->name},
+            {"time"s, item.time},
+            {"type"s, "Wait"s}
+        };
+    }
+    return Dict{
+        {"bus"s, item.bus->name},
+        {"span_count"s, item.span_count},
+        {"time"s, item.time},
+        {"type"s, "Bus"s}
+    };
 }
 
 json::Dict JsonReader::ExecQueryRoute(std:: string from, std:: string to, int req_id){
 
     using namespace json;
 
+    RequireRouter();
+
+    if(const Dict* cached = route_cache_.Find(from, to)) {
+        Dict answer = *cached;
+        answer["request_id"s] = req_id;
+        return answer;
+    }
+
+    Dict answer;
     auto route = request_handler_.BuildRoute(from, to);
     if(route == std::nullopt) {
-        return Builder{}.StartDict()
-            .Key("request_id"s).Value(req_id)
+        answer = Builder{}.StartDict()
             .Key("error_message"s).Value("not found"s)
         .EndDict().Build().AsDict();
+    } else {
+        Array items{};
+        items.reserve(route->items.size());
+        for(const auto& item : route->items) {
+            items.push_back(GetRouteItem(item));
+        }
+
+        answer = json::Builder{}
+                            .StartDict()
+                                .Key("items"s).Value(std::move(items))
+                                .Key("total_time"s).Value(route->total_time)
+                            .EndDict().Build().AsDict();
     }
 
-    Array items{};
-    for(auto& item : route->items) {
-        Dict dict{};
-        for(auto& [key, value] : item) {
-            Node node;
-            dict.insert({key, GetNodeValue(value)});
+    route_cache_.Put(from, to, answer);
+    answer["request_id"s] = req_id;
+    return answer;
+}
+
+json::Dict JsonReader::ExecQueryMatrix(const json::Array& from, const json::Array& to, int req_id) {
+
+    using namespace json;
+
+    RequireRouter();
+
+    std::vector<std::string_view> from_names, to_names;
+    for(const auto& stop : from) {
+        from_names.push_back(stop.AsString());
+    }
+    for(const auto& stop : to) {
+        to_names.push_back(stop.AsString());
+    }
+
+    // one unknown stop fails the request, not the batch
+    const auto is_known = [this](std::string_view name) { return catalogue_.FindStop(name) != nullptr; };
+    if(!std::all_of(from_names.begin(), from_names.end(), is_known)
+       || !std::all_of(to_names.begin(), to_names.end(), is_known)) {
+        return Builder{}.StartDict()
+                            .Key("request_id"s).Value(req_id)
+                            .Key("error_message"s).Value("not found"s)
+                        .EndDict().Build().AsDict();
+    }
+
+    const auto matrix = request_handler_.BuildMatrix(from_names, to_names);
+
+    // null for no route
+    Array rows;
+    rows.reserve(matrix.size());
+    for(const auto& row : matrix) {
+        Array times;
+        times.reserve(row.size());
+        for(const auto& time : row) {
+            times.push_back(time ? Node(*time) : Node(nullptr));
         }
-        items.push_back(std::move(dict));
+        rows.push_back(std::move(times));
     }
 
-    return json::Builder{}
-                        .StartDict()
-                            .Key("items"s).Value(items)
+    return Builder{}.StartDict()
+                        .Key("request_id"s).Value(req_id)
+                        .Key("total_time"s).Value(std::move(rows))
+                    .EndDict().Build().AsDict();
+}
+
+json::Dict JsonReader::ExecQueryIsochrone(std::string from, double max_time, int req_id) {
+
+    using namespace json;
+
+    RequireRouter();
+
+    if(catalogue_.FindStop(from) == nullptr) {
+        return Builder{}.StartDict()
                             .Key("request_id"s).Value(req_id)
-                            .Key("total_time"s).Value(route->total_time)
+                            .Key("error_message"s).Value("not found"s)
                         .EndDict().Build().AsDict();
+    }
+
+    Array items;
+    for(const auto& [stop, time] : request_handler_.BuildIsochrone(from, max_time)) {
+        items.push_back(Builder{}.StartDict()
+                                    .Key("stop_name"s).Value(stop->name)
+                                    .Key("time"s).Value(time)
+                                 .EndDict().Build());
+    }
+
+    return Builder{}.StartDict()
+                        .Key("items"s).Value(std::move(items))
+                        .Key("request_id"s).Value(req_id)
+                    .EndDict().Build().AsDict();
+}
+
+json::Dict JsonReader::ExecQueryRouterStats(int req_id) {
+
+    using namespace json;
+
+    RequireRouter();
+
+    const auto stats = request_handler_.GetRouterStats();
+
+    Dict answer{{"request_id"s, req_id}};
+    if(stats.tree_cache) {
+        const auto& cache = *stats.tree_cache;
+        answer["tree_cache"s] = Builder{}
+                                .StartDict()
+                                    .Key("hits"s).Value(static_cast<int>(cache.hits))
+                                    .Key("misses"s).Value(static_cast<int>(cache.misses))
+                                    .Key("evictions"s).Value(static_cast<int>(cache.evictions))
+                                    .Key("trees"s).Value(static_cast<int>(cache.trees))
+                                    .Key("capacity"s).Value(static_cast<int>(cache.capacity))
+                                    .Key("invalidations"s).Value(static_cast<int>(cache.invalidations))
+                                .EndDict().Build();
+    }
+    if(const auto cache = route_cache_.GetStats(); cache.capacity != 0) {
+        const size_t lookups = cache.hits + cache.misses;
+        answer["route_cache"s] = Builder{}
+                                 .StartDict()
+                                     .Key("hits"s).Value(static_cast<int>(cache.hits))
+                                     .Key("misses"s).Value(static_cast<int>(cache.misses))
+                                     .Key("hit_rate"s).Value(
+                                         lookups == 0 ? 0.0 : static_cast<double>(cache.hits) / lookups)
+                                     .Key("replacements"s).Value(static_cast<int>(cache.replacements))
+                                     .Key("entries"s).Value(static_cast<int>(cache.entries))
+                                     .Key("capacity"s).Value(static_cast<int>(cache.capacity))
+                                 .EndDict().Build();
+    }
+    if(stats.search) {
+        const auto& search = *stats.search;
+        answer["search"s] = Builder{}
+                            .StartDict()
+                                .Key("searches"s).Value(static_cast<int>(search.searches))
+                                .Key("settled_vertices"s).Value(static_cast<int>(search.settled_vertices))
+                                .Key("max_settled_vertices"s).Value(static_cast<int>(search.max_settled_vertices))
+                            .EndDict().Build();
+    }
+    if(stats.hub_labels) {
+        const auto& labels = *stats.hub_labels;
+        const double entries = static_cast<double>(labels.out_entries + labels.in_entries);
+        answer["hub_labels"s] = Builder{}
+                                .StartDict()
+                                    .Key("out_entries"s).Value(static_cast<int>(labels.out_entries))
+                                    .Key("in_entries"s).Value(static_cast<int>(labels.in_entries))
+                                    .Key("max_label_size"s).Value(static_cast<int>(labels.max_label_size))
+                                    .Key("average_label_size"s).Value(
+                                        labels.vertices == 0 ? 0.0 : entries / (2 * labels.vertices))
+                                .EndDict().Build();
+    }
+    return answer;
 }
 
 } //namespace transport
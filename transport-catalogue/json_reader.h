@@ -3,6 +3,10 @@
 #include "json.h"
 #include "transport_catalogue.h"
 #include "request_handler.h"
+#include "route_cache.h"
+#include "serialization.h"
+
+#include <memory>
 
 namespace transport {
 
@@ -21,12 +25,21 @@ public:
 
     void BaseSave(transport::TransportRouter&);
 
+    // opens the base, only the catalogue is loaded here, see LazyBase
     void BaseLoad(transport::TransportRouter&);
 
+    // parts of the base needed by the requests, loaded on the first call
+    void RequireRouter();
+
+    void RequireRenderSettings();
+
     json::Dict ExecQueryStop(std:: string stop_name, int req_id);
 
     json::Dict ExecQueryBus(std:: string bus_name, int req_id);
 
+    // "update_requests": catalogue changes applied after the base is loaded
+    void ApplyUpdates();
+
     void ExecQueries();
 
     std::string FormatColor(const json::Node& color) const;
@@ -39,15 +52,25 @@ public:
 
     bool SetRouterSettings();
 
-    json::Node GetNodeValue(TransportRouter::ItemValue value);
+    json::Node GetRouteItem(const TransportRouter::RouteItem& item);
 
     json::Dict ExecQueryRoute(std:: string from, std:: string to, int req_id);
 
+    json::Dict ExecQueryMatrix(const json::Array& from, const json::Array& to, int req_id);
+
+    json::Dict ExecQueryIsochrone(std::string from, double max_time, int req_id);
+
+    json::Dict ExecQueryRouterStats(int req_id);
+
 private:
     TransportCatalogue& catalogue_;
     json::Node root_node_;
     RequestHandler& request_handler_;
     renderer::RenderSettings render_rettings_;
+    // Route answers without request_id, valid until the next update of the catalogue
+    RouteCache<json::Dict> route_cache_;
+    std::unique_ptr<LazyBase> base_;
+    bool router_required_ = false;
 };
 
 } //namespace transport
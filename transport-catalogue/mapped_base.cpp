@@ -0,0 +1,232 @@
+#include "mapped_base.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mapped {
+
+namespace {
+
+size_t Align(size_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+}  // namespace
+
+Writer::Writer(const std::string& fname)
+    : fname_(fname)
+    , out_(fname, std::ios::binary)
+{
+    if (!out_) {
+        throw std::runtime_error("Can't write the base file " + fname);
+    }
+    // zeros until Finish()
+    const Header header{};
+    Write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void Writer::Write(const char* data, size_t size) {
+    out_.write(data, static_cast<std::streamsize>(size));
+    offset_ += size;
+}
+
+void Writer::AddSection(SectionId id, std::string_view data, uint32_t version) {
+    BeginSection(id, version);
+    Append(data);
+    EndSection();
+}
+
+void Writer::BeginSection(SectionId id, uint32_t version) {
+    if (in_section_) {
+        throw std::logic_error("Previous section isn't ended");
+    }
+    const char padding[SECTION_ALIGNMENT] = {};
+    Write(padding, Align(offset_) - offset_);
+    table_.push_back({id, version, offset_, 0});
+    in_section_ = true;
+}
+
+void Writer::Append(std::string_view data) {
+    Write(data.data(), data.size());
+}
+
+void Writer::EndSection() {
+    table_.back().size = offset_ - table_.back().offset;
+    in_section_ = false;
+}
+
+void Writer::Finish() {
+    if (in_section_) {
+        EndSection();
+    }
+    const char padding[SECTION_ALIGNMENT] = {};
+    Write(padding, Align(offset_) - offset_);
+
+    Header header{};
+    std::copy(MAGIC.begin(), MAGIC.end(), header.magic);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.version = FORMAT_VERSION;
+    header.section_count = table_.size();
+    header.table_offset = offset_;
+    Write(reinterpret_cast<const char*>(table_.data()), table_.size() * sizeof(Section));
+
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Can't write the base file " + fname_);
+    }
+}
+
+File::File(const std::string& fname) {
+#ifdef _WIN32
+    file_ = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        throw std::runtime_error("Can't open the base file " + fname);
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file_, &size)) {
+        Unmap();
+        throw std::runtime_error("Can't open the base file " + fname);
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ != 0) {
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        data_ = mapping_ != nullptr ?
+                static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        if (data_ == nullptr) {
+            Unmap();
+            throw std::runtime_error("Can't map the base file " + fname);
+        }
+    }
+#else
+    const int fd = open(fname.c_str(), O_RDONLY);
+    struct stat file_stat{};
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("Can't open the base file " + fname);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ != 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Can't map the base file " + fname);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);  // the mapping stays
+#endif
+
+    // version 1 header ends before table_offset, its table follows
+    constexpr size_t header_size_v1 = offsetof(Header, table_offset);
+    if (size_ < header_size_v1) {
+        Unmap();
+        ThrowCorrupted();
+    }
+    const auto* header = reinterpret_cast<const Header*>(data_);
+    if (std::string_view(header->magic, sizeof(header->magic)) != MAGIC
+        || header->byte_order != BYTE_ORDER_MARK || header->version == 0 || header->version > FORMAT_VERSION
+        || (header->version > 1 && size_ < sizeof(Header))) {
+        Unmap();
+        ThrowCorrupted();
+    }
+    const size_t table_offset = header->version == 1 ? header_size_v1 : header->table_offset;
+    if (table_offset % alignof(Section) != 0 || table_offset > size_
+        || header->section_count > (size_ - table_offset) / sizeof(Section)) {
+        Unmap();
+        ThrowCorrupted();
+    }
+    sections_ = reinterpret_cast<const Section*>(data_ + table_offset);
+    section_count_ = header->section_count;
+    for (size_t i = 0; i < section_count_; ++i) {
+        const auto& section = sections_[i];
+        if (section.offset % SECTION_ALIGNMENT != 0 || section.offset > size_ || section.size > size_ - section.offset) {
+            Unmap();
+            ThrowCorrupted();
+        }
+    }
+    strings_ = GetSection(SectionId::STRINGS);
+}
+
+File::~File() {
+    Unmap();
+}
+
+void File::Unmap() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr) {
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    mapping_ = file_ = nullptr;
+#else
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+#endif
+}
+
+bool File::IsMapped(const std::string& fname) {
+    std::ifstream in(fname, std::ios::binary);
+    char magic[MAGIC.size()] = {};
+    in.read(magic, sizeof(magic));
+    return in && std::string_view(magic, sizeof(magic)) == MAGIC;
+}
+
+const Section* File::FindSection(SectionId id) const {
+    for (size_t i = 0; i < section_count_; ++i) {
+        if (sections_[i].id == id) {
+            return &sections_[i];
+        }
+    }
+    return nullptr;
+}
+
+std::string_view File::GetSection(SectionId id) const {
+    const Section* section = FindSection(id);
+    if (section == nullptr) {
+        return {};
+    }
+    return {data_ + section->offset, section->size};
+}
+
+uint32_t File::GetSectionVersion(SectionId id) const {
+    const Section* section = FindSection(id);
+    return section != nullptr ? section->version : 0;
+}
+
+std::string_view File::GetString(String string) const {
+    if (string.offset > strings_.size() || string.size > strings_.size() - string.offset) {
+        ThrowCorrupted();
+    }
+    return strings_.substr(string.offset, string.size);
+}
+
+void File::ThrowCorrupted() {
+    throw std::runtime_error("Mapped base file is corrupted");
+}
+
+}  // namespace mapped
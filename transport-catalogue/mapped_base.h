@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace mapped {
+
+// Base file of sections: Header, the sections at SECTION_ALIGNMENT offsets, then the Section table
+// (right after the Header in version 1).
+// Fixed-layout sections are used in place after mmap, protobuf ones are parsed when their part
+// of the base is needed, so a reader touches only the pages of the sections it loads.
+// Numbers are in the byte order of the machine, BYTE_ORDER_MARK rejects the others
+constexpr std::string_view MAGIC = "TCMAPPED";
+constexpr uint32_t FORMAT_VERSION = 2;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr size_t SECTION_ALIGNMENT = 64;
+
+enum class SectionId : uint32_t {
+    META = 1,           // protobuf TransportCatalogue: render and router settings
+                        // (CH or hub labels too in the bases without GRAPH)
+    STRINGS,            // names of stops and buses
+    STOPS,              // Stop, index is the stop id
+    BUSES,              // Bus, index is the bus id
+    BUS_STOPS,          // uint32 stop ids of all buses
+    DISTANCES,          // Distance
+    ROUTER_EDGES,       // RouterEdge, index is the edge id
+    GRAPH_EDGES,        // GraphEdge, index is the edge id
+    GRAPH_INFO,         // GraphInfo
+    TABLE_INFO,         // TableInfo, ALL_PAIRS and ALL_PAIRS_DENSE only
+    TABLE_WEIGHTS,      // row-major weights of the table
+    TABLE_PREV_EDGES,   // row-major uint32 prev edges of the table
+    // protobuf sections of the bases without the fixed-layout ones above
+    CATALOGUE,          // Catalogue, instead of STRINGS ... DISTANCES
+    ROUTER,             // Router, instead of ROUTER_EDGES
+    GRAPH,              // Graph: CH or hub labels; the edges and the table if there are no
+                        // GRAPH_EDGES and TABLE_INFO
+};
+
+struct Header {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t section_count;
+    uint64_t table_offset;  // since version 2
+};
+
+struct Section {
+    SectionId id;
+    uint32_t version;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// part of the STRINGS section
+struct String {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Stop {
+    String name;
+    double lat;
+    double lng;
+};
+
+struct Bus {
+    String name;
+    uint32_t first_stop;    // in BUS_STOPS
+    uint32_t stop_count;
+    int32_t last_stop;      // -1 for none
+    uint32_t reserved;
+};
+
+struct Distance {
+    uint32_t from;
+    uint32_t to;
+    double val;
+};
+
+struct RouterEdge {
+    uint32_t bus;
+    uint32_t from;
+    uint32_t to;
+    uint32_t span;
+    int32_t type;
+    uint32_t reserved;
+    double time;
+};
+
+struct GraphEdge {
+    uint32_t from;
+    uint32_t to;
+    double weight;
+};
+
+struct GraphInfo {
+    uint64_t vertex_count;
+};
+
+// NO_EDGE and "no route" weight are the ones of graph::DenseRouter<Weight>
+struct TableInfo {
+    uint64_t vertex_count;
+    int32_t weight_type;    // TransportRouter::WeightType
+    uint32_t reserved;
+};
+
+// Sections go to the file as they are added, nothing is kept but the Section table.
+// The Header is written by Finish(), a file left unfinished isn't recognized as a base
+class Writer {
+public:
+    // throws std::runtime_error if the file can't be created
+    explicit Writer(const std::string& fname);
+
+    void AddSection(SectionId id, std::string_view data, uint32_t version = 1);
+
+    template <typename T>
+    void AddArray(SectionId id, const std::vector<T>& items, uint32_t version = 1) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        AddSection(id, {reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T)}, version);
+    }
+
+    template <typename T>
+    void AddValue(SectionId id, const T& value, uint32_t version = 1) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        AddSection(id, {reinterpret_cast<const char*>(&value), sizeof(T)}, version);
+    }
+
+    // section written in parts, f.e. row by row; no other section until EndSection()
+    void BeginSection(SectionId id, uint32_t version = 1);
+
+    void Append(std::string_view data);
+
+    void EndSection();
+
+    // Section table and Header, throws std::runtime_error if the file can't be written
+    void Finish();
+
+private:
+    void Write(const char* data, size_t size);
+
+    std::string fname_;
+    std::ofstream out_;
+    size_t offset_ = 0;  // end of the written data
+    std::vector<Section> table_;
+    bool in_section_ = false;
+};
+
+// Read-only mapping of the whole file, unmapped in destructor
+class File {
+public:
+    // throws std::runtime_error if the file can't be mapped or isn't a mapped base
+    explicit File(const std::string& fname);
+    ~File();
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    // true if the file starts with MAGIC, false for other bases (protobuf)
+    static bool IsMapped(const std::string& fname);
+
+    // empty for a missing section
+    std::string_view GetSection(SectionId id) const;
+
+    uint32_t GetSectionVersion(SectionId id) const;
+
+    // items of the section in place, throws std::runtime_error if the size doesn't fit T
+    template <typename T>
+    const T* GetArray(SectionId id, size_t& count) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const std::string_view section = GetSection(id);
+        if (section.size() % sizeof(T) != 0) {
+            ThrowCorrupted();
+        }
+        count = section.size() / sizeof(T);
+        return reinterpret_cast<const T*>(section.data());
+    }
+
+    template <typename T>
+    const T& GetValue(SectionId id) const {
+        size_t count = 0;
+        const T* value = GetArray<T>(id, count);
+        if (count != 1) {
+            ThrowCorrupted();
+        }
+        return *value;
+    }
+
+    std::string_view GetString(String string) const;
+
+private:
+    void Unmap();
+
+    const Section* FindSection(SectionId id) const;
+
+    [[noreturn]] static void ThrowCorrupted();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const Section* sections_ = nullptr;
+    size_t section_count_ = 0;
+    std::string_view strings_;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+}  // namespace mapped
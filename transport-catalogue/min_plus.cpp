@@ -0,0 +1,245 @@
+#include "min_plus.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MIN_PLUS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace graph {
+
+#ifdef MIN_PLUS_X86
+
+namespace {
+
+// AVX2: 4 doubles or 8 floats per step, cells without improvement are not written
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double weight_from, uint32_t prev_edge_from,
+                  const double* through_weights, const uint32_t* through_prev_edges,
+                  double* row_weights, uint32_t* row_prev_edges,
+                  size_t count, uint32_t no_edge) {
+    const __m256d from = _mm256_set1_pd(weight_from);
+    const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m128i none = _mm_set1_epi32(static_cast<int>(no_edge));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(through_weights + i));
+        const __m256d row = _mm256_loadu_pd(row_weights + i);
+        const __m256d less = _mm256_cmp_pd(candidate, row, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(less) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(row_weights + i, _mm256_blendv_pd(row, candidate, less));
+
+        // 64-bit lane mask -> 32-bit lane mask
+        const __m128i less32 = _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(_mm256_castpd256_pd128(less)),
+                                                               _mm_castpd_ps(_mm256_extractf128_pd(less, 1)),
+                                                               _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i through_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(through_prev_edges + i));
+        const __m128i prev = _mm_blendv_epi8(through_prev, prev_from, _mm_cmpeq_epi32(through_prev, none));
+        const __m128i row_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_prev_edges + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row_prev_edges + i), _mm_blendv_epi8(row_prev, prev, less32));
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, through_weights + i, through_prev_edges + i,
+                   row_weights + i, row_prev_edges + i, count - i, no_edge);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(float weight_from, uint32_t prev_edge_from,
+                  const float* through_weights, const uint32_t* through_prev_edges,
+                  float* row_weights, uint32_t* row_prev_edges,
+                  size_t count, uint32_t no_edge) {
+    const __m256 from = _mm256_set1_ps(weight_from);
+    const __m256i prev_from = _mm256_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m256i none = _mm256_set1_epi32(static_cast<int>(no_edge));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 candidate = _mm256_add_ps(from, _mm256_loadu_ps(through_weights + i));
+        const __m256 row = _mm256_loadu_ps(row_weights + i);
+        const __m256 less = _mm256_cmp_ps(candidate, row, _CMP_LT_OQ);
+        if (_mm256_movemask_ps(less) == 0) {
+            continue;
+        }
+        _mm256_storeu_ps(row_weights + i, _mm256_blendv_ps(row, candidate, less));
+
+        const __m256i through_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(through_prev_edges + i));
+        const __m256i prev = _mm256_blendv_epi8(through_prev, prev_from, _mm256_cmpeq_epi32(through_prev, none));
+        const __m256i row_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_prev_edges + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row_prev_edges + i),
+                            _mm256_blendv_epi8(row_prev, prev, _mm256_castps_si256(less)));
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, through_weights + i, through_prev_edges + i,
+                   row_weights + i, row_prev_edges + i, count - i, no_edge);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double weight_from, uint64_t prev_edge_from,
+                  const double* through_weights, const uint64_t* through_prev_edges,
+                  double* row_weights, uint64_t* row_prev_edges,
+                  size_t count, uint64_t no_edge) {
+    const __m256d from = _mm256_set1_pd(weight_from);
+    const __m256i prev_from = _mm256_set1_epi64x(static_cast<long long>(prev_edge_from));
+    const __m256i none = _mm256_set1_epi64x(static_cast<long long>(no_edge));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(through_weights + i));
+        const __m256d row = _mm256_loadu_pd(row_weights + i);
+        const __m256d less = _mm256_cmp_pd(candidate, row, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(less) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(row_weights + i, _mm256_blendv_pd(row, candidate, less));
+
+        const __m256i through_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(through_prev_edges + i));
+        const __m256i prev = _mm256_blendv_epi8(through_prev, prev_from, _mm256_cmpeq_epi64(through_prev, none));
+        const __m256i row_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_prev_edges + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row_prev_edges + i),
+                            _mm256_blendv_epi8(row_prev, prev, _mm256_castpd_si256(less)));
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, through_weights + i, through_prev_edges + i,
+                   row_weights + i, row_prev_edges + i, count - i, no_edge);
+}
+
+// AVX-512: 8 doubles or 16 floats per step, masked stores
+
+__attribute__((target("avx512f,avx512vl")))
+void RelaxRowAvx512(double weight_from, uint32_t prev_edge_from,
+                    const double* through_weights, const uint32_t* through_prev_edges,
+                    double* row_weights, uint32_t* row_prev_edges,
+                    size_t count, uint32_t no_edge) {
+    const __m512d from = _mm512_set1_pd(weight_from);
+    const __m256i prev_from = _mm256_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m256i none = _mm256_set1_epi32(static_cast<int>(no_edge));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512d candidate = _mm512_add_pd(from, _mm512_loadu_pd(through_weights + i));
+        const __mmask8 less = _mm512_cmp_pd_mask(candidate, _mm512_loadu_pd(row_weights + i), _CMP_LT_OQ);
+        if (less == 0) {
+            continue;
+        }
+        _mm512_mask_storeu_pd(row_weights + i, less, candidate);
+
+        const __m256i through_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(through_prev_edges + i));
+        const __m256i prev = _mm256_mask_blend_epi32(_mm256_cmpeq_epi32_mask(through_prev, none),
+                                                     through_prev, prev_from);
+        _mm256_mask_storeu_epi32(row_prev_edges + i, less, prev);
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, through_weights + i, through_prev_edges + i,
+                   row_weights + i, row_prev_edges + i, count - i, no_edge);
+}
+
+__attribute__((target("avx512f,avx512vl")))
+void RelaxRowAvx512(float weight_from, uint32_t prev_edge_from,
+                    const float* through_weights, const uint32_t* through_prev_edges,
+                    float* row_weights, uint32_t* row_prev_edges,
+                    size_t count, uint32_t no_edge) {
+    const __m512 from = _mm512_set1_ps(weight_from);
+    const __m512i prev_from = _mm512_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m512i none = _mm512_set1_epi32(static_cast<int>(no_edge));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 candidate = _mm512_add_ps(from, _mm512_loadu_ps(through_weights + i));
+        const __mmask16 less = _mm512_cmp_ps_mask(candidate, _mm512_loadu_ps(row_weights + i), _CMP_LT_OQ);
+        if (less == 0) {
+            continue;
+        }
+        _mm512_mask_storeu_ps(row_weights + i, less, candidate);
+
+        const __m512i through_prev = _mm512_loadu_si512(through_prev_edges + i);
+        const __m512i prev = _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(through_prev, none),
+                                                     through_prev, prev_from);
+        _mm512_mask_storeu_epi32(row_prev_edges + i, less, prev);
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, through_weights + i, through_prev_edges + i,
+                   row_weights + i, row_prev_edges + i, count - i, no_edge);
+}
+
+__attribute__((target("avx512f,avx512vl")))
+void RelaxRowAvx512(double weight_from, uint64_t prev_edge_from,
+                    const double* through_weights, const uint64_t* through_prev_edges,
+                    double* row_weights, uint64_t* row_prev_edges,
+                    size_t count, uint64_t no_edge) {
+    const __m512d from = _mm512_set1_pd(weight_from);
+    const __m512i prev_from = _mm512_set1_epi64(static_cast<long long>(prev_edge_from));
+    const __m512i none = _mm512_set1_epi64(static_cast<long long>(no_edge));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512d candidate = _mm512_add_pd(from, _mm512_loadu_pd(through_weights + i));
+        const __mmask8 less = _mm512_cmp_pd_mask(candidate, _mm512_loadu_pd(row_weights + i), _CMP_LT_OQ);
+        if (less == 0) {
+            continue;
+        }
+        _mm512_mask_storeu_pd(row_weights + i, less, candidate);
+
+        const __m512i through_prev = _mm512_loadu_si512(through_prev_edges + i);
+        const __m512i prev = _mm512_mask_blend_epi64(_mm512_cmpeq_epi64_mask(through_prev, none),
+                                                     through_prev, prev_from);
+        _mm512_mask_storeu_epi64(row_prev_edges + i, less, prev);
+    }
+    RelaxRowScalar(weight_from, prev_edge_from, through_weights + i, through_prev_edges + i,
+                   row_weights + i, row_prev_edges + i, count - i, no_edge);
+}
+
+template <typename Weight, typename PrevEdge>
+RelaxRowFunction<Weight, PrevEdge> GetVectorRelaxRow(MinPlusIsa isa) {
+    if (!IsSupported(isa)) {
+        return nullptr;
+    }
+    switch (isa) {
+    case MinPlusIsa::AVX512:
+        return &RelaxRowAvx512;
+    case MinPlusIsa::AVX2:
+        return &RelaxRowAvx2;
+    case MinPlusIsa::SCALAR:
+        break;
+    }
+    return &RelaxRowScalar<Weight, PrevEdge>;
+}
+
+}  // namespace
+
+bool IsSupported(MinPlusIsa isa) {
+    switch (isa) {
+    case MinPlusIsa::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+    case MinPlusIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case MinPlusIsa::SCALAR:
+        break;
+    }
+    return true;
+}
+
+#else
+
+namespace {
+
+template <typename Weight, typename PrevEdge>
+RelaxRowFunction<Weight, PrevEdge> GetVectorRelaxRow(MinPlusIsa isa) {
+    return isa == MinPlusIsa::SCALAR ? &RelaxRowScalar<Weight, PrevEdge> : nullptr;
+}
+
+}  // namespace
+
+bool IsSupported(MinPlusIsa isa) {
+    return isa == MinPlusIsa::SCALAR;
+}
+
+#endif
+
+template <>
+RelaxRowFunction<double, uint32_t> GetRelaxRow<double, uint32_t>(MinPlusIsa isa) {
+    return GetVectorRelaxRow<double, uint32_t>(isa);
+}
+
+template <>
+RelaxRowFunction<float, uint32_t> GetRelaxRow<float, uint32_t>(MinPlusIsa isa) {
+    return GetVectorRelaxRow<float, uint32_t>(isa);
+}
+
+template <>
+RelaxRowFunction<double, uint64_t> GetRelaxRow<double, uint64_t>(MinPlusIsa isa) {
+    return GetVectorRelaxRow<double, uint64_t>(isa);
+}
+
+}  // namespace graph
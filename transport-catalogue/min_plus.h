@@ -0,0 +1,72 @@
+#pragma once
+
+#include "weight_traits.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace graph {
+
+// Min-plus row update of Floyd–Warshall through one vertex:
+// row[j] = min(row[j], weight_from + through[j]) for j in [0, count),
+// prev edge of an improved cell is through_prev[j], or prev_edge_from when through_prev[j] == no_edge.
+// Sums go through WeightTraits, fixed-point "no route" stays unreachable.
+// Vector versions take the same additions and comparisons lane by lane, so results equal the scalar loop
+template <typename Weight, typename PrevEdge>
+using RelaxRowFunction = void (*)(Weight weight_from, PrevEdge prev_edge_from,
+                                  const Weight* through_weights, const PrevEdge* through_prev_edges,
+                                  Weight* row_weights, PrevEdge* row_prev_edges,
+                                  size_t count, PrevEdge no_edge);
+
+// instruction sets of the kernels, in order of preference
+enum class MinPlusIsa {
+    AVX512,
+    AVX2,
+    SCALAR,
+};
+
+bool IsSupported(MinPlusIsa isa);
+
+template <typename Weight, typename PrevEdge>
+void RelaxRowScalar(Weight weight_from, PrevEdge prev_edge_from,
+                    const Weight* through_weights, const PrevEdge* through_prev_edges,
+                    Weight* row_weights, PrevEdge* row_prev_edges,
+                    size_t count, PrevEdge no_edge) {
+    for (size_t i = 0; i < count; ++i) {
+        const Weight candidate_weight = WeightTraits<Weight>::Add(weight_from, through_weights[i]);
+        if (candidate_weight < row_weights[i]) {
+            row_weights[i] = candidate_weight;
+            row_prev_edges[i] = through_prev_edges[i] != no_edge ? through_prev_edges[i] : prev_edge_from;
+        }
+    }
+}
+
+// kernel for the instruction set, nullptr if there's no such version for the types or the CPU lacks it.
+// Vector versions exist for double + uint32, float + uint32 and double + uint64 tables
+template <typename Weight, typename PrevEdge>
+RelaxRowFunction<Weight, PrevEdge> GetRelaxRow(MinPlusIsa isa) {
+    return isa == MinPlusIsa::SCALAR ? &RelaxRowScalar<Weight, PrevEdge> : nullptr;
+}
+
+template <>
+RelaxRowFunction<double, uint32_t> GetRelaxRow<double, uint32_t>(MinPlusIsa isa);
+
+template <>
+RelaxRowFunction<float, uint32_t> GetRelaxRow<float, uint32_t>(MinPlusIsa isa);
+
+template <>
+RelaxRowFunction<double, uint64_t> GetRelaxRow<double, uint64_t>(MinPlusIsa isa);
+
+// best kernel for this CPU
+template <typename Weight, typename PrevEdge>
+RelaxRowFunction<Weight, PrevEdge> SelectRelaxRow() {
+    for (const MinPlusIsa isa : {MinPlusIsa::AVX512, MinPlusIsa::AVX2}) {
+        if (const auto relax_row = GetRelaxRow<Weight, PrevEdge>(isa)) {
+            return relax_row;
+        }
+    }
+    return &RelaxRowScalar<Weight, PrevEdge>;
+}
+
+}  // namespace graph
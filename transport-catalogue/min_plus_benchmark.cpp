@@ -0,0 +1,127 @@
+// One relaxation pass of Floyd–Warshall (a row through one vertex) for every min-plus kernel.
+// Rows are refreshed before every timed batch, about a quarter of the cells improve.
+// Usage: min_plus_benchmark [row_length ...]
+
+#include "min_plus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t ROW_COUNT = 64;
+constexpr size_t CELLS_PER_LENGTH = 1 << 26;
+
+template <typename Weight, typename PrevEdge>
+struct Rows {
+    std::vector<Weight> through_weights;
+    std::vector<PrevEdge> through_prev_edges;
+    std::vector<Weight> weights;       // ROW_COUNT rows
+    std::vector<PrevEdge> prev_edges;
+    std::vector<Weight> weights_from;  // d[row][through]
+    std::vector<PrevEdge> prev_edges_from;
+};
+
+template <typename Weight, typename PrevEdge>
+Rows<Weight, PrevEdge> MakeRows(size_t length, PrevEdge no_edge) {
+    constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::infinity();
+    std::mt19937 generator(static_cast<unsigned>(length));
+    std::uniform_real_distribution<double> weight(0.5, 100.0);
+    std::uniform_int_distribution<uint32_t> edge(0, 1 << 20);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    Rows<Weight, PrevEdge> rows;
+    for (size_t i = 0; i < length; ++i) {
+        const bool reachable = percent(generator) < 90;
+        rows.through_weights.push_back(reachable ? static_cast<Weight>(weight(generator)) : UNREACHABLE);
+        rows.through_prev_edges.push_back(reachable && percent(generator) < 95 ? edge(generator) : no_edge);
+    }
+    for (size_t i = 0; i < ROW_COUNT * length; ++i) {
+        const bool reachable = percent(generator) < 80;
+        rows.weights.push_back(reachable ? static_cast<Weight>(weight(generator) + 50.0) : UNREACHABLE);
+        rows.prev_edges.push_back(reachable ? edge(generator) : no_edge);
+    }
+    for (size_t i = 0; i < ROW_COUNT; ++i) {
+        rows.weights_from.push_back(static_cast<Weight>(weight(generator) * 0.6));
+        rows.prev_edges_from.push_back(edge(generator));
+    }
+    return rows;
+}
+
+template <typename Weight, typename PrevEdge>
+void Run(const std::string& name, size_t length) {
+    constexpr PrevEdge NO_EDGE = std::numeric_limits<PrevEdge>::max();
+    const auto rows = MakeRows<Weight, PrevEdge>(length, NO_EDGE);
+    const size_t batches = std::max<size_t>(1, CELLS_PER_LENGTH / (ROW_COUNT * length));
+
+    for (const auto& [isa, isa_name] : {std::pair{graph::MinPlusIsa::SCALAR, "scalar"s},
+                                        std::pair{graph::MinPlusIsa::AVX2, "avx2"s},
+                                        std::pair{graph::MinPlusIsa::AVX512, "avx512"s}}) {
+        const auto relax_row = graph::GetRelaxRow<Weight, PrevEdge>(isa);
+        if (!relax_row) {
+            std::cout << std::left << std::setw(16) << name << std::setw(8) << isa_name
+                      << std::right << std::setw(8) << length << "   not supported\n"sv;
+            continue;
+        }
+
+        std::vector<Weight> weights;
+        std::vector<PrevEdge> prev_edges;
+        std::chrono::steady_clock::duration elapsed{};
+        for (size_t batch = 0; batch < batches; ++batch) {
+            weights = rows.weights;
+            prev_edges = rows.prev_edges;
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t row = 0; row < ROW_COUNT; ++row) {
+                relax_row(rows.weights_from[row], rows.prev_edges_from[row],
+                          rows.through_weights.data(), rows.through_prev_edges.data(),
+                          weights.data() + row * length, prev_edges.data() + row * length,
+                          length, NO_EDGE);
+            }
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+
+        // all kernels must give the same rows
+        double checksum = 0.0;
+        for (size_t i = 0; i < weights.size(); ++i) {
+            if (weights[i] != std::numeric_limits<Weight>::infinity()) {
+                checksum += weights[i] + static_cast<double>(prev_edges[i] % 1000);
+            }
+        }
+        const double cells = static_cast<double>(batches * ROW_COUNT * length);
+        std::cout << std::left << std::setw(16) << name << std::setw(8) << isa_name
+                  << std::right << std::setw(8) << length
+                  << std::setw(12) << std::fixed << std::setprecision(3)
+                  << std::chrono::duration<double, std::nano>(elapsed).count() / cells
+                  << std::setw(18) << std::setprecision(2) << checksum << '\n';
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> lengths{64, 1000, 4096};
+    if (argc > 1) {
+        lengths.clear();
+        for (int i = 1; i < argc; ++i) {
+            lengths.push_back(std::stoul(argv[i]));
+        }
+    }
+
+    std::cout << "table           kernel    length  ns / cell          checksum\n"sv;
+    for (const size_t length : lengths) {
+        Run<double, uint32_t>("double + uint32"s, length);
+        Run<float, uint32_t>("float + uint32"s, length);
+        Run<double, uint64_t>("double + uint64"s, length);
+    }
+    return EXIT_SUCCESS;
+}
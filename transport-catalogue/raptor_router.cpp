@@ -0,0 +1,193 @@
+#include "raptor_router.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace transport {
+
+namespace {
+
+constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+constexpr size_t NO_STOP = std::numeric_limits<size_t>::max();
+
+}
+
+RaptorRouter::RaptorRouter(const TransportCatalogue& catalog, double wait, double velocity,
+                           const std::unordered_set<const Bus*>& removed_buses)
+    : wait_(wait) {
+
+    for(const Stop& stop : catalog.GetStops()) {
+        stops_.push_back(&stop);
+    }
+
+    event_offsets_.assign(stops_.size() + 1, 0);
+    for(const auto& bus : catalog.GetBuses()) {
+        if(removed_buses.count(&bus) != 0) continue;
+        Line line{&bus, line_stops_.size(), line_stops_.size()};
+        Stop* prev = nullptr;
+        for(auto stop : bus.stops) {
+            // same time as the span edges of the graph
+            const double time = prev == nullptr ? 0.0 : 60.0 * catalog.GetDistance(prev, stop) / 1000 / velocity;
+            line_stops_.push_back(stop->id);
+            segment_times_.push_back(time);
+            ++event_offsets_[stop->id + 1];
+            prev = stop;
+        }
+        line.end = line_stops_.size();
+        lines_.push_back(line);
+    }
+
+    for(size_t i = 1; i < event_offsets_.size(); ++i) {
+        event_offsets_[i] += event_offsets_[i - 1];
+    }
+    events_.resize(line_stops_.size());
+    std::vector<size_t> filled(event_offsets_.begin(), event_offsets_.end() - 1);
+    for(size_t line = 0; line < lines_.size(); ++line) {
+        for(size_t position = lines_[line].begin; position < lines_[line].end; ++position) {
+            events_[filled[line_stops_[position]]++] = {line, position};
+        }
+    }
+}
+
+double RaptorRouter::RideTime(size_t board, size_t alight) const {
+    // summed in the same order as span_time of TransportRouter::FillGraph
+    double time = 0.0;
+    for(size_t position = board + 1; position <= alight; ++position) {
+        time += segment_times_[position];
+    }
+    return time;
+}
+
+std::optional<RaptorRouter::Journey> RaptorRouter::BuildRoute(size_t from, size_t to) const {
+    if(from >= stops_.size() || to >= stops_.size()) {
+        throw std::out_of_range("Stop id is out of range");
+    }
+
+    std::vector<double> arrivals;
+    std::vector<Parent> parents;
+    Scan(from, to, UNREACHED, arrivals, parents);
+
+    if(arrivals[to] == UNREACHED) {
+        return std::nullopt;
+    }
+
+    Journey journey{arrivals[to], {}};
+    for(size_t stop = to; stop != from; ) {
+        const auto& parent = parents[stop];
+        const auto& line = lines_[parent.line];
+        const size_t board_stop = line_stops_[parent.board];
+        journey.legs.push_back({line.bus, stops_[board_stop], parent.alight - parent.board,
+                                RideTime(parent.board, parent.alight)});
+        stop = board_stop;
+    }
+    std::reverse(journey.legs.begin(), journey.legs.end());
+
+    return journey;
+}
+
+std::vector<std::optional<double>> RaptorRouter::BuildTimes(size_t from, const std::vector<size_t>& to) const {
+    if(from >= stops_.size() || std::any_of(to.begin(), to.end(), [this](size_t stop) {
+           return stop >= stops_.size();
+       })) {
+        throw std::out_of_range("Stop id is out of range");
+    }
+
+    std::vector<double> arrivals;
+    std::vector<Parent> parents;
+    Scan(from, NO_STOP, UNREACHED, arrivals, parents);
+
+    std::vector<std::optional<double>> times;
+    times.reserve(to.size());
+    for(const size_t stop : to) {
+        times.push_back(arrivals[stop] == UNREACHED ? std::nullopt : std::optional<double>(arrivals[stop]));
+    }
+    return times;
+}
+
+std::vector<std::pair<size_t, double>> RaptorRouter::BuildReachable(size_t from, double max_time) const {
+    if(from >= stops_.size()) {
+        throw std::out_of_range("Stop id is out of range");
+    }
+
+    std::vector<double> arrivals;
+    std::vector<Parent> parents;
+    Scan(from, NO_STOP, max_time, arrivals, parents);
+
+    std::vector<std::pair<size_t, double>> reachable;
+    for(size_t stop = 0; stop < arrivals.size(); ++stop) {
+        if(arrivals[stop] != UNREACHED) {
+            reachable.push_back({stop, arrivals[stop]});
+        }
+    }
+    return reachable;
+}
+
+void RaptorRouter::Scan(size_t from, size_t to, double max_arrival,
+                        std::vector<double>& arrivals, std::vector<Parent>& parents) const {
+    arrivals.assign(stops_.size(), UNREACHED);
+    parents.assign(stops_.size(), {});
+    const double no_target = UNREACHED;
+    const double* target_arrival = to == NO_STOP ? &no_target : &arrivals[to];
+
+    std::vector<bool> is_marked(stops_.size(), false);
+    std::vector<size_t> marked{from};
+    std::vector<size_t> line_starts(lines_.size(), NO_POSITION);
+    std::vector<size_t> queued_lines;
+    arrivals[from] = 0.0;
+    is_marked[from] = true;
+
+    while(!marked.empty()) {
+        // lines through the improved stops, each from its first improved stop
+        for(const size_t stop : marked) {
+            is_marked[stop] = false;
+            for(size_t i = event_offsets_[stop]; i < event_offsets_[stop + 1]; ++i) {
+                const auto [line, position] = events_[i];
+                if(line_starts[line] == NO_POSITION) {
+                    queued_lines.push_back(line);
+                    line_starts[line] = position;
+                } else {
+                    line_starts[line] = std::min(line_starts[line], position);
+                }
+            }
+        }
+        marked.clear();
+
+        for(const size_t line : queued_lines) {
+            bool on_board = false;
+            size_t board = 0;
+            double board_time = 0.0;  // arrival at the boarding stop + wait
+            double ride_time = 0.0;
+            for(size_t position = line_starts[line]; position < lines_[line].end; ++position) {
+                const size_t stop = line_stops_[position];
+                if(on_board) {
+                    ride_time += segment_times_[position];
+                    const double arrival = board_time + ride_time;
+                    if(arrival < arrivals[stop] && arrival < *target_arrival
+                       && arrival <= max_arrival) {
+                        arrivals[stop] = arrival;
+                        parents[stop] = {line, board, position};
+                        if(!is_marked[stop]) {
+                            is_marked[stop] = true;
+                            marked.push_back(stop);
+                        }
+                    }
+                }
+                // staying on board is cheaper unless boarding here beats it
+                if(arrivals[stop] != UNREACHED
+                   && (!on_board || arrivals[stop] + wait_ < board_time + ride_time)) {
+                    on_board = true;
+                    board = position;
+                    board_time = arrivals[stop] + wait_;
+                    ride_time = 0.0;
+                }
+            }
+            line_starts[line] = NO_POSITION;
+        }
+        queued_lines.clear();
+    }
+}
+
+} // namespace transport
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "domain.h"
+
+#include <optional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace transport {
+
+class TransportCatalogue;
+
+// Round-based engine (RAPTOR) over Bus::stops sequences: every round is one more boarding,
+// a bus is scanned from the first stop improved in the previous round.
+// Span edges are not built, memory is linear in the number of stop events (stops of all buses)
+class RaptorRouter {
+
+public:
+
+    // one boarding: wait at `from`, then ride `span_count` segments
+    struct Leg {
+        const Bus* bus;
+        const Stop* from;
+        size_t span_count;
+        double time;
+    };
+
+    struct Journey {
+        double total_time;
+        std::vector<Leg> legs;
+    };
+
+    // removed_buses are out of service and not scanned
+    RaptorRouter(const TransportCatalogue& catalog, double wait, double velocity,
+                 const std::unordered_set<const Bus*>& removed_buses = {});
+
+    // stops are indexed by Stop::id
+    std::optional<Journey> BuildRoute(size_t from, size_t to) const;
+
+    // one-to-many: arrival times from `from` to every stop of `to`, std::nullopt for no route
+    std::vector<std::optional<double>> BuildTimes(size_t from, const std::vector<size_t>& to) const;
+
+    // stops reachable from `from` within max_time with their arrival times, by stop id
+    std::vector<std::pair<size_t, double>> BuildReachable(size_t from, double max_time) const;
+
+private:
+
+    // stops of the bus are [begin, end) of line_stops_
+    struct Line {
+        const Bus* bus;
+        size_t begin;
+        size_t end;
+    };
+
+    struct StopEvent {
+        size_t line;
+        size_t position;
+    };
+
+    // how the stop was reached: line and positions of boarding and alighting
+    struct Parent {
+        size_t line;
+        size_t board;
+        size_t alight;
+    };
+
+    // rounds from `from`, arrivals later than the one at `to` (NO_STOP - no target)
+    // or than max_arrival are pruned
+    void Scan(size_t from, size_t to, double max_arrival,
+              std::vector<double>& arrivals, std::vector<Parent>& parents) const;
+
+    double RideTime(size_t board, size_t alight) const;
+
+    double wait_;
+    std::vector<const Stop*> stops_;
+    std::vector<Line> lines_;
+    std::vector<size_t> line_stops_;     // stop ids of all lines one after another
+    std::vector<double> segment_times_;  // ride time from the previous stop of the line, 0 for the first
+    std::vector<size_t> event_offsets_;  // events of stop i are [event_offsets_[i], event_offsets_[i + 1])
+    std::vector<StopEvent> events_;
+};
+
+} // namespace transport
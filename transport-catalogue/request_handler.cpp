@@ -136,4 +136,25 @@ std::optional<TransportRouter::Route> RequestHandler::BuildRoute(std::string_vie
     return router_.BuildRoute(from, to);
 }
 
+TransportRouter::Matrix RequestHandler::BuildMatrix(const std::vector<std::string_view>& from,
+                                                    const std::vector<std::string_view>& to) const {
+    return router_.BuildMatrix(from, to);
+}
+
+TransportRouter::Isochrone RequestHandler::BuildIsochrone(std::string_view from, double max_time) const {
+    return router_.BuildIsochrone(from, max_time);
+}
+
+const TransportRouter::Settings& RequestHandler::GetRouterSettings() const {
+    return router_.GetSettings();
+}
+
+TransportRouter::Stats RequestHandler::GetRouterStats() const {
+    return router_.GetStats();
+}
+
+void RequestHandler::UpdateRouter(const TransportRouter::Update& update) {
+    router_.ApplyUpdate(update);
+}
+
 } //namespace transport
@@ -33,8 +33,19 @@ public:
 
     void InitRouter(const TransportRouter::Settings settings);
 
+    const TransportRouter::Settings& GetRouterSettings() const;
+
     std::optional<TransportRouter::Route> BuildRoute(std::string_view from, std::string_view to) const;
 
+    TransportRouter::Matrix BuildMatrix(const std::vector<std::string_view>& from,
+                                        const std::vector<std::string_view>& to) const;
+
+    TransportRouter::Isochrone BuildIsochrone(std::string_view from, double max_time) const;
+
+    TransportRouter::Stats GetRouterStats() const;
+
+    void UpdateRouter(const TransportRouter::Update& update);
+
 private:
     // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
     const transport::TransportCatalogue& db_;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace transport {
+
+// counters of the route answer cache
+struct RouteCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t replacements = 0;  // answers pushed out of their slot by another pair
+    size_t entries = 0;       // answers in the cache now
+    size_t capacity = 0;      // slots
+};
+
+// Formatted answers of Route requests by (from, to). Direct-mapped: the hash of the pair
+// picks one slot, a new pair takes it over, so lookups are one hash and two string compares.
+// Capacity 0 - no cache. Not synchronized, answers are formatted in one thread
+template <typename Answer>
+class RouteCache {
+public:
+    explicit RouteCache(size_t capacity = 0)
+        : slots_(capacity)
+    {
+        stats_.capacity = capacity;
+    }
+
+    // nullptr if the pair isn't cached
+    const Answer* Find(std::string_view from, std::string_view to) {
+        if (slots_.empty()) {
+            return nullptr;
+        }
+        const auto& slot = slots_[Slot(from, to)];
+        if (slot && slot->from == from && slot->to == to) {
+            ++stats_.hits;
+            return &slot->answer;
+        }
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    void Put(std::string_view from, std::string_view to, Answer answer) {
+        if (slots_.empty()) {
+            return;
+        }
+        auto& slot = slots_[Slot(from, to)];
+        if (slot) {
+            ++stats_.replacements;
+        } else {
+            ++stats_.entries;
+        }
+        slot = Entry{std::string(from), std::string(to), std::move(answer)};
+    }
+
+    RouteCacheStats GetStats() const {
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        std::string from;
+        std::string to;
+        Answer answer;
+    };
+
+    size_t Slot(std::string_view from, std::string_view to) const {
+        const std::hash<std::string_view> hasher;
+        return (hasher(from) * 37 + hasher(to)) % slots_.size();
+    }
+
+    std::vector<std::optional<Entry>> slots_;
+    RouteCacheStats stats_;
+};
+
+}  // namespace transport
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "floyd_warshall.h"
 #include "graph.h"
+#include "shortest_path_tree.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -19,30 +23,100 @@ namespace transport {
 namespace graph {
 
 template <typename Weight>
-class Router {
+struct RouteInfo {
+    Weight weight;
+    std::vector<EdgeId> edges;
+};
 
-    friend class transport::Serial;
+// Common interface of the routing engines: all-pairs table, on-demand searches etc.
+template <typename Weight>
+class RouterEngine {
+public:
+    virtual ~RouterEngine() = default;
 
-private:
-    using Graph = DirectedWeightedGraph<Weight>;
+    virtual std::optional<RouteInfo<Weight>> BuildRoute(VertexId from, VertexId to) const = 0;
 
-public:
-    explicit Router(const Graph& graph);
+    // appends the edges of the route to the caller's buffer (f.e. one reused between queries)
+    // and returns its weight, std::nullopt and no edges for no route
+    virtual std::optional<Weight> AppendRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+        auto route = BuildRoute(from, to);
+        if (!route) {
+            return std::nullopt;
+        }
+        edges.insert(edges.end(), route->edges.begin(), route->edges.end());
+        return route->weight;
+    }
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    // one-to-many: route weights from `from` to every vertex of `to`, std::nullopt for no route.
+    // Engines with a table or a one-to-many search override it
+    virtual std::vector<std::optional<Weight>> BuildWeights(VertexId from, const std::vector<VertexId>& to) const {
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(to.size());
+        for (const VertexId vertex : to) {
+            if (auto route = BuildRoute(from, vertex)) {
+                weights.push_back(route->weight);
+            } else {
+                weights.push_back(std::nullopt);
+            }
+        }
+        return weights;
+    }
+
+    // the graph was edited (Thaw() ... Freeze()): `changed_edges` got new weights, were added
+    // or removed. Returns false if the engine can't follow and has to be built again
+    virtual bool Update(const std::vector<EdgeId>& changed_edges) {
+        (void)changed_edges;
+        return false;
+    }
+};
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+// All-pairs engine: Floyd–Warshall in constructor, O(V^2) table.
+// Optional next-hop table: first edge of every route (uint32, V^2 more), routes are read
+// front to back by it instead of walking the prev edges and reversing
+template <typename Weight>
+class Router final : public RouterEngine<Weight> {
+
+    friend class transport::Serial;
 
 private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
     struct RouteInternalData {
         Weight weight;
         std::optional<EdgeId> prev_edge;
     };
     using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
+    // thread_count != 1 - tiled Floyd–Warshall on the pool (0 - all cores), same table
+    explicit Router(const Graph& graph, size_t thread_count = 1, bool next_hops = false);
+
+    // restores computed table (f.e. from the base file), next hops are computed from it
+    Router(const Graph& graph, RoutesInternalData routes_internal_data, bool next_hops = false);
+
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    std::optional<Weight> AppendRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const override;
+
+    std::vector<std::optional<Weight>> BuildWeights(VertexId from, const std::vector<VertexId>& to) const override;
+
+    // rows which may change are computed again by Dijkstra, the others stay
+    bool Update(const std::vector<EdgeId>& changed_edges) override;
+
+private:
+    using NextEdge = uint32_t;
+    static constexpr NextEdge NO_NEXT_EDGE = std::numeric_limits<NextEdge>::max();
+
+    // row `from` of the next-hop table from the prev edges of the same row, O(V)
+    void FillNextEdges(VertexId from);
+
+    void FillNextEdges();
+
+    // false if the hops go round (zero-weight cycles make equal routes of other rows meet)
+    bool AppendNextHops(VertexId from, VertexId to, std::vector<EdgeId>& edges) const;
+
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
@@ -82,43 +156,234 @@ private:
         }
     }
 
+    // runs the tiled loop over a flat copy of the table
+    void RelaxRoutesInternalDataBlocked(size_t vertex_count, size_t thread_count) {
+        using Kernel = FloydWarshall<Weight, EdgeId>;
+        constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        std::vector<Weight> weights(vertex_count * vertex_count, Kernel::UNREACHABLE);
+        std::vector<EdgeId> prev_edges(vertex_count * vertex_count, NO_EDGE);
+        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+            for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+                if (const auto& route = routes_internal_data_[vertex_from][vertex_to]) {
+                    weights[vertex_from * vertex_count + vertex_to] = route->weight;
+                    prev_edges[vertex_from * vertex_count + vertex_to] = route->prev_edge.value_or(NO_EDGE);
+                }
+            }
+        }
+
+        concurrency::ThreadPool pool(thread_count);
+        Kernel(vertex_count, weights.data(), prev_edges.data(), NO_EDGE).Run(pool);
+
+        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+            for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+                const size_t cell = vertex_from * vertex_count + vertex_to;
+                if (weights[cell] != Kernel::UNREACHABLE) {
+                    routes_internal_data_[vertex_from][vertex_to] = RouteInternalData{
+                        weights[cell],
+                        prev_edges[cell] != NO_EDGE ? std::optional<EdgeId>(prev_edges[cell]) : std::nullopt};
+                }
+            }
+        }
+    }
+
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
     RoutesInternalData routes_internal_data_;
+    bool next_hops_ = false;
+    std::vector<NextEdge> next_edges_;  // row-major, empty without next hops
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+Router<Weight>::Router(const Graph& graph, size_t thread_count, bool next_hops)
     : graph_(graph)
     , routes_internal_data_(graph.GetVertexCount(),
                             std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , next_hops_(next_hops)
 {
     InitializeRoutesInternalData(graph);
 
     const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    if (thread_count != 1) {
+        RelaxRoutesInternalDataBlocked(vertex_count, thread_count);
+    } else {
+        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        }
     }
+    FillNextEdges();
 }
 
 template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+Router<Weight>::Router(const Graph& graph, RoutesInternalData routes_internal_data, bool next_hops)
+    : graph_(graph)
+    , routes_internal_data_(std::move(routes_internal_data))
+    , next_hops_(next_hops)
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    if (routes_internal_data_.size() != vertex_count) {
+        throw std::invalid_argument("Routes table doesn't match the graph");
+    }
+    for (const auto& routes_from : routes_internal_data_) {
+        if (routes_from.size() != vertex_count) {
+            throw std::invalid_argument("Routes table doesn't match the graph");
+        }
+    }
+    FillNextEdges();
+}
+
+template <typename Weight>
+void Router<Weight>::FillNextEdges() {
+    next_edges_.clear();
+    if (!next_hops_) {
+        return;
+    }
+    if (graph_.GetEdgeCount() >= NO_NEXT_EDGE) {
+        throw std::length_error("Too many edges for 32-bit edge ids");
+    }
+    const size_t vertex_count = routes_internal_data_.size();
+    next_edges_.assign(vertex_count * vertex_count, NO_NEXT_EDGE);
+    for (VertexId from = 0; from < vertex_count; ++from) {
+        FillNextEdges(from);
+    }
+}
+
+template <typename Weight>
+void Router<Weight>::FillNextEdges(VertexId from) {
+    const size_t vertex_count = routes_internal_data_.size();
+    const auto& routes_from = routes_internal_data_[from];
+    NextEdge* row_next_edges = &next_edges_[from * vertex_count];
+    std::fill(row_next_edges, row_next_edges + vertex_count, NO_NEXT_EDGE);
+
+    // walks up the prev edges to a vertex with a known first edge (or to a child of `from`),
+    // then gives that first edge to the whole walk
+    std::vector<VertexId> walk;
+    for (VertexId to = 0; to < vertex_count; ++to) {
+        VertexId vertex = to;
+        while (row_next_edges[vertex] == NO_NEXT_EDGE && routes_from[vertex] && routes_from[vertex]->prev_edge) {
+            const EdgeId edge_id = *routes_from[vertex]->prev_edge;
+            const VertexId prev_vertex = graph_.GetEdge(edge_id).from;
+            if (prev_vertex == from) {
+                row_next_edges[vertex] = static_cast<NextEdge>(edge_id);
+                break;
+            }
+            walk.push_back(vertex);
+            vertex = prev_vertex;
+        }
+        for (const VertexId walked : walk) {
+            row_next_edges[walked] = row_next_edges[vertex];
+        }
+        walk.clear();
+    }
+}
+
+template <typename Weight>
+bool Router<Weight>::AppendNextHops(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+    const size_t vertex_count = routes_internal_data_.size();
+    const size_t first = edges.size();
+    for (VertexId vertex = from; vertex != to;) {
+        const NextEdge edge_id = next_edges_[vertex * vertex_count + to];
+        if (edge_id == NO_NEXT_EDGE || edges.size() - first == vertex_count) {
+            edges.resize(first);
+            return false;
+        }
+        edges.push_back(edge_id);
+        vertex = graph_.GetEdge(edge_id).to;
+    }
+    return true;
+}
+
+template <typename Weight>
+std::optional<Weight> Router<Weight>::AppendRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+    const size_t vertex_count = routes_internal_data_.size();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const auto& routes_from = routes_internal_data_[from];
+    const auto& route_internal_data = routes_from[to];
     if (!route_internal_data) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
-    std::vector<EdgeId> edges;
+    if (!next_edges_.empty() && AppendNextHops(from, to, edges)) {
+        return route_internal_data->weight;
+    }
+
+    const size_t first = edges.size();
     for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = routes_from[graph_.GetEdge(*edge_id).from]->prev_edge)
     {
         edges.push_back(*edge_id);
     }
-    std::reverse(edges.begin(), edges.end());
+    std::reverse(edges.begin() + first, edges.end());
+
+    return route_internal_data->weight;
+}
+
+template <typename Weight>
+std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
+                                                                             VertexId to) const {
+    std::vector<EdgeId> edges;
+    const auto weight = AppendRoute(from, to, edges);
+    if (!weight) {
+        return std::nullopt;
+    }
+    return RouteInfo{*weight, std::move(edges)};
+}
 
-    return RouteInfo{weight, std::move(edges)};
+template <typename Weight>
+bool Router<Weight>::Update(const std::vector<EdgeId>& changed_edges) {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (vertex_count != routes_internal_data_.size()
+        || (!next_edges_.empty() && graph_.GetEdgeCount() >= NO_NEXT_EDGE)) {
+        return false;
+    }
+    for (VertexId from = 0; from < vertex_count; ++from) {
+        auto& routes_from = routes_internal_data_[from];
+        const bool is_affected = IsTreeAffected(graph_, changed_edges,
+            [&routes_from](VertexId to) {
+                const auto& route = routes_from[to];
+                return route ? std::optional<Weight>(route->weight) : std::nullopt;
+            },
+            [&routes_from](VertexId to) {
+                const auto& route = routes_from[to];
+                return route ? route->prev_edge : std::nullopt;
+            });
+        if (!is_affected) {
+            continue;
+        }
+        const auto tree = BuildShortestPathTree(graph_, from);
+        for (VertexId to = 0; to < vertex_count; ++to) {
+            if (!tree.weights[to]) {
+                routes_from[to] = std::nullopt;
+                continue;
+            }
+            const EdgeId prev_edge = tree.prev_edges[to];
+            routes_from[to] = RouteInternalData{
+                *tree.weights[to],
+                prev_edge != ShortestPathTree<Weight>::NO_EDGE ? std::optional<EdgeId>(prev_edge) : std::nullopt};
+        }
+        if (!next_edges_.empty()) {
+            FillNextEdges(from);
+        }
+    }
+    return true;
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> Router<Weight>::BuildWeights(VertexId from,
+                                                                const std::vector<VertexId>& to) const {
+    const auto& routes_from = routes_internal_data_.at(from);
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(to.size());
+    for (const VertexId vertex : to) {
+        if (const auto& route_internal_data = routes_from.at(vertex)) {
+            weights.push_back(route_internal_data->weight);
+        } else {
+            weights.push_back(std::nullopt);
+        }
+    }
+    return weights;
 }
 
 }  // namespace graph
@@ -0,0 +1,123 @@
+// Compares table layouts of the all-pairs routers on synthetic graphs:
+// Router (vector of vectors of optionals) and DenseRouter (flat weights + uint32 prev edges),
+// plus the tiled Floyd–Warshall on all cores. The fixed-point table keeps 1/6000 minute units,
+// its checksum is in these units.
+// Usage: router_benchmark [vertex_count ...]
+
+#include "dense_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t EDGES_PER_VERTEX = 8;
+constexpr size_t QUERY_COUNT = 200000;
+
+template <typename Weight>
+graph::DirectedWeightedGraph<Weight> MakeGraph(size_t vertex_count, unsigned seed, double scale = 1.0) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+    std::uniform_real_distribution<double> weight(0.5, 30.0);
+
+    graph::DirectedWeightedGraph<Weight> graph(vertex_count);
+    for (size_t i = 0; i < vertex_count * EDGES_PER_VERTEX; ++i) {
+        graph.AddEdge({vertex(generator), vertex(generator), static_cast<Weight>(weight(generator) * scale)});
+    }
+    return graph;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Router, typename Weight>
+void Run(const std::string& name, const graph::DirectedWeightedGraph<Weight>& graph, size_t table_bytes,
+         size_t thread_count = 1) {
+    const size_t vertex_count = graph.GetVertexCount();
+
+    auto start = std::chrono::steady_clock::now();
+    const Router router(graph, thread_count);
+    const double build_seconds = Seconds(start);
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+    double checksum = 0.0;
+    size_t edge_count = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        if (const auto route = router.BuildRoute(vertex(generator), vertex(generator))) {
+            checksum += route->weight;
+            edge_count += route->edges.size();
+        }
+    }
+    const double query_seconds = Seconds(start);
+
+    std::cout << std::left << std::setw(22) << name << std::right
+              << std::setw(8) << vertex_count
+              << std::setw(12) << std::fixed << std::setprecision(3) << build_seconds
+              << std::setw(12) << std::setprecision(3) << query_seconds * 1e6 / QUERY_COUNT
+              << std::setw(12) << std::setprecision(1) << table_bytes / 1048576.0
+              << std::setw(16) << std::setprecision(2) << checksum
+              << std::setw(12) << edge_count << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes{250, 500, 1000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; ++i) {
+            sizes.push_back(std::stoul(argv[i]));
+        }
+    }
+
+    // cell of Router's table: optional<RouteInternalData{weight, optional<EdgeId>}>
+    struct RouterCell {
+        double weight;
+        std::optional<graph::EdgeId> prev_edge;
+    };
+    constexpr size_t router_cell_bytes = sizeof(std::optional<RouterCell>);
+
+    // at least two threads, so the tiled loop runs even on one core
+    const size_t thread_count = std::max(2u, std::thread::hardware_concurrency());
+    const std::string threads = ", "s + std::to_string(thread_count) + "t"s;
+
+    std::cout << "layout                vertices   build, s   query, us  table, MiB        checksum       edges\n"sv;
+    for (const size_t vertex_count : sizes) {
+        const size_t cells = vertex_count * vertex_count;
+        const auto graph = MakeGraph<double>(vertex_count, static_cast<unsigned>(vertex_count));
+        const auto float_graph = MakeGraph<float>(vertex_count, static_cast<unsigned>(vertex_count));
+        const auto fixed_graph = MakeGraph<uint32_t>(vertex_count, static_cast<unsigned>(vertex_count), 6000.0);
+
+        Run<graph::Router<double>>("optional<double>"s, graph,
+                                   cells * router_cell_bytes
+                                   + vertex_count * sizeof(std::vector<std::optional<RouterCell>>));
+        Run<graph::DenseRouter<double>>("flat double + uint32"s, graph,
+                                        cells * (sizeof(double) + sizeof(uint32_t)));
+        Run<graph::DenseRouter<float>>("flat float + uint32"s, float_graph,
+                                       cells * (sizeof(float) + sizeof(uint32_t)));
+        Run<graph::DenseRouter<uint32_t>>("flat fixed + uint32"s, fixed_graph,
+                                          cells * (sizeof(uint32_t) + sizeof(uint32_t)));
+        Run<graph::Router<double>>("optional<double>"s + threads, graph,
+                                   cells * router_cell_bytes
+                                   + vertex_count * sizeof(std::vector<std::optional<RouterCell>>),
+                                   thread_count);
+        Run<graph::DenseRouter<double>>("flat double"s + threads, graph,
+                                        cells * (sizeof(double) + sizeof(uint32_t)), thread_count);
+    }
+    return EXIT_SUCCESS;
+}
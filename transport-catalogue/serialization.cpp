@@ -1,41 +1,177 @@
 #include "serialization.h"
+#include "mapped_base.h"
+
+namespace {
+
+// version of the all-pairs table in Graph: 1 - RoutesInternalData message per cell (old bases),
+// 2 - RouteRow: bitmap of the cells with a route, packed weights and delta-coded prev edges
+constexpr uint32_t ROUTES_VERSION = 2;
+
+// table weights: each Weight has its own field and, in version 1 cells, its own "no route" value
+
+void AddRowWeight(transport::serial::RouteRow& row, double weight) {
+    row.add_weights(weight);
+}
+
+void AddRowWeight(transport::serial::RouteRow& row, float weight) {
+    row.add_float_weights(weight);
+}
+
+void AddRowWeight(transport::serial::RouteRow& row, uint32_t weight) {
+    row.add_fixed_weights(weight);
+}
+
+template <typename Weight>
+const google::protobuf::RepeatedField<Weight>& GetRowWeights(const transport::serial::RouteRow& row);
+
+template <>
+const google::protobuf::RepeatedField<double>& GetRowWeights<double>(const transport::serial::RouteRow& row) {
+    return row.weights();
+}
+
+template <>
+const google::protobuf::RepeatedField<float>& GetRowWeights<float>(const transport::serial::RouteRow& row) {
+    return row.float_weights();
+}
+
+template <>
+const google::protobuf::RepeatedField<uint32_t>& GetRowWeights<uint32_t>(const transport::serial::RouteRow& row) {
+    return row.fixed_weights();
+}
+
+template <typename Weight>
+std::optional<Weight> GetTableWeight(const transport::serial::RouteInternalData& data);
+
+template <>
+std::optional<double> GetTableWeight<double>(const transport::serial::RouteInternalData& data) {
+    return data.weight() != -1.0 ? std::optional<double>(data.weight()) : std::nullopt;
+}
+
+template <>
+std::optional<float> GetTableWeight<float>(const transport::serial::RouteInternalData& data) {
+    return data.float_weight() != -1.0f ? std::optional<float>(data.float_weight()) : std::nullopt;
+}
+
+template <>
+std::optional<uint32_t> GetTableWeight<uint32_t>(const transport::serial::RouteInternalData& data) {
+    return data.fixed_weight() != graph::WeightTraits<uint32_t>::UNREACHABLE ?
+                std::optional<uint32_t>(data.fixed_weight()) : std::nullopt;
+}
+
+// row `from` of the table, cell(to) -> std::optional<std::pair<Weight, std::optional<EdgeId>>>
+template <typename Weight, typename Cell>
+void SaveRouteRow(transport::serial::RouteRow& row, size_t vertex_count, Cell cell) {
+    std::string reachable((vertex_count + 7) / 8, '\0');
+    int64_t prev_code = 0;
+    for(size_t to = 0; to < vertex_count; ++to) {
+        const auto route = cell(to);
+        if(!route) continue;
+        reachable[to / 8] |= static_cast<char>(1 << (to % 8));
+        AddRowWeight(row, route->first);
+        // neighbouring vertices are mostly reached by close edges, the deltas are short varints
+        const int64_t code = route->second ? static_cast<int64_t>(*route->second) + 1 : 0;
+        row.add_prev_edge_deltas(code - prev_code);
+        prev_code = code;
+    }
+    row.set_reachable(std::move(reachable));
+}
+
+// route(from, to, weight, prev_edge) for every cell with a route, tables of both versions
+template <typename Weight, typename Route>
+void LoadRouteCells(const transport::serial::Graph& graph, Route route) {
+    if(graph.routes_version() < ROUTES_VERSION) {
+        size_t from = 0;
+        for(const auto& routes_internal_data : graph.routes_internal_data()) {
+            size_t to = 0;
+            for(const auto& route_internal_data : routes_internal_data.route_internal_data()) {
+                if(const auto weight = GetTableWeight<Weight>(route_internal_data)) {
+                    route(from, to, *weight, route_internal_data.prev_edge() == -1 ?
+                          std::nullopt : std::optional<graph::EdgeId>(route_internal_data.prev_edge()));
+                }
+                ++to;
+            }
+            ++from;
+        }
+        return;
+    }
+
+    size_t from = 0;
+    for(const auto& row : graph.route_rows()) {
+        const auto& weights = GetRowWeights<Weight>(row);
+        const auto& prev_edge_deltas = row.prev_edge_deltas();
+        if(weights.size() != prev_edge_deltas.size()) {
+            throw std::runtime_error("Routes table is corrupted");
+        }
+        const std::string& reachable = row.reachable();
+        int cell = 0;
+        int64_t prev_code = 0;
+        for(size_t to = 0; to < reachable.size() * 8; ++to) {
+            if((static_cast<unsigned char>(reachable[to / 8]) >> (to % 8) & 1) == 0) continue;
+            if(cell == weights.size()) {
+                throw std::runtime_error("Routes table is corrupted");
+            }
+            prev_code += prev_edge_deltas[cell];
+            route(from, to, weights[cell],
+                  prev_code == 0 ? std::nullopt : std::optional<graph::EdgeId>(prev_code - 1));
+            ++cell;
+        }
+        if(cell != weights.size()) {
+            throw std::runtime_error("Routes table is corrupted");
+        }
+        ++from;
+    }
+}
+
+// a missing section parses as an empty message
+template <typename Message>
+void ParseSection(const mapped::File& file, mapped::SectionId id, Message& message) {
+    const auto data = file.GetSection(id);
+    if(data.size() > static_cast<size_t>(std::numeric_limits<int>::max())
+       || !message.ParseFromArray(data.data(), static_cast<int>(data.size()))) {
+        throw std::runtime_error("Base file is corrupted");
+    }
+}
+
+}  // namespace
 
 bool transport::Serial::SaveCatalogue(TransportCatalogue& catalogue_,
                                       transport::serial::Catalogue& catalogue) {
 
+    catalogue.mutable_stops()->Reserve(static_cast<int>(catalogue_.stops_.size()));
     for(const auto& stop_ : catalogue_.stops_) {
-        transport::serial::Stop stop;
+        transport::serial::Stop& stop = *catalogue.add_stops();
         stop.set_name(stop_.name);
         stop.set_lat(stop_.coordinates.lat);
         stop.set_lng(stop_.coordinates.lng);
         stop.set_id(stop_.id);
-        *catalogue.add_stops() = std::move(stop);
     }
 
+    catalogue.mutable_distances()->Reserve(static_cast<int>(catalogue_.distances_.size()));
     for(const auto& [key, val] : catalogue_.distances_) {
-        transport::serial::Distance dist;
+        transport::serial::Distance& dist = *catalogue.add_distances();
         dist.set_from(key.from_ptr->id);
         dist.set_to(key.to_ptr->id);
         dist.set_val(val);
-        *catalogue.add_distances() = std::move(dist);
     }
 
+    catalogue.mutable_buses()->Reserve(static_cast<int>(catalogue_.buses_.size()));
     for(const auto& bus_ : catalogue_.buses_) {
-        transport::serial::Bus bus;
+        transport::serial::Bus& bus = *catalogue.add_buses();
         bus.set_name(bus_.name);
         bus.set_id(bus_.id);
         bus_.last_stop == nullptr ?
                     bus.set_last_stop(-1) :
                     bus.set_last_stop(bus_.last_stop->id);
+        bus.mutable_stops()->Reserve(static_cast<int>(bus_.stops.size()));
         for(const auto& stop : bus_.stops) bus.add_stops(stop->id);
-        *catalogue.add_buses() = std::move(bus);
     }
 
+    catalogue.mutable_stop_buses()->Reserve(static_cast<int>(catalogue_.stops_buses_indx_.size()));
     for(const auto& [stop_, buses_] : catalogue_.stops_buses_indx_) {
-        transport::serial::StopBuses buses;
+        transport::serial::StopBuses& buses = *catalogue.add_stop_buses();
         buses.set_id(stop_->id);
+        buses.mutable_buses()->Reserve(static_cast<int>(buses_.size()));
         for(const auto& bus_ : buses_) buses.add_buses(bus_->id);
-        *catalogue.add_stop_buses() = std::move(buses);
     }
 
     return true;
@@ -51,17 +187,14 @@ bool transport::Serial::SaveRenderSettings(
     render_settings.set_stroke_width(render_settings_.stroke_width);
     render_settings.set_stop_radius(render_settings_.stop_radius);
     render_settings.set_bus_label_font_size(render_settings_.bus_label_font_size);
-    transport::serial::Point point;
-    point.set_x(render_settings_.bus_label_offset.x);
-    point.set_y(render_settings_.bus_label_offset.y);
-    *render_settings.mutable_bus_label_offset() = std::move(point);
+    render_settings.mutable_bus_label_offset()->set_x(render_settings_.bus_label_offset.x);
+    render_settings.mutable_bus_label_offset()->set_y(render_settings_.bus_label_offset.y);
     render_settings.set_stop_label_font_size(render_settings_.stop_label_font_size);
-    transport::serial::Point point2;
-    point2.set_x(render_settings_.stop_label_offset.x);
-    point2.set_y(render_settings_.stop_label_offset.y);
-    *render_settings.mutable_stop_label_offset() = std::move(point2);
+    render_settings.mutable_stop_label_offset()->set_x(render_settings_.stop_label_offset.x);
+    render_settings.mutable_stop_label_offset()->set_y(render_settings_.stop_label_offset.y);
     render_settings.set_underlayer_color(render_settings_.underlayer_color);
     render_settings.set_underlayer_width(render_settings_.underlayer_width);
+    render_settings.mutable_stroke_color()->Reserve(static_cast<int>(render_settings_.stroke_color.size()));
     for(const auto& color_: render_settings_.stroke_color)
         render_settings.add_stroke_color(color_);
     render_settings.set_fill_color(render_settings_.fill_color);
@@ -73,29 +206,36 @@ bool transport::Serial::SaveRenderSettings(
     return true;
 }
 
-bool transport::Serial::SaveRouter(TransportRouter& router_,
-                                   transport::serial::Router& router) {
+bool transport::Serial::SaveRouterSettings(TransportRouter& router_,
+                                           transport::serial::RouterSettings& router_settings) {
 
-    transport::serial::RouterSettings router_settings;
     router_settings.set_wait(router_.settings_.wait);
     router_settings.set_velocity(router_.settings_.velocity);
-    *router.mutable_router_settings() = std::move(router_settings);
+    router_settings.set_engine(static_cast<int>(router_.settings_.engine));
+    router_settings.set_tree_cache_bytes(router_.settings_.tree_cache_bytes);
+    router_settings.set_graph_model(static_cast<int>(router_.settings_.graph_model));
+    router_settings.set_stop_vertices_only(router_.settings_.stop_vertices_only);
+    router_settings.set_weight_type(static_cast<int>(router_.settings_.weight_type));
+    router_settings.set_next_hops(router_.settings_.next_hops);
+    router_settings.set_route_cache_entries(router_.settings_.route_cache_entries);
 
-    for(const auto& [name_, number_] : router_.stops_) {
-        transport::serial::RouterStop router_stop;
-        router_stop.set_name(name_);
-        router_stop.set_number(number_);
-        *router.add_router_stops() = std::move(router_stop);
-    }
+    return true;
+}
+
+bool transport::Serial::SaveRouter(TransportRouter& router_,
+                                   transport::serial::Router& router) {
 
+    SaveRouterSettings(router_, *router.mutable_router_settings());
+
+    router.mutable_router_edge_idx()->Reserve(static_cast<int>(router_.edges_.size()));
     for(const auto& edge_ : router_.edges_) {
-        transport::serial::RouterEdgeIdx edge;
+        transport::serial::RouterEdgeIdx& edge = *router.add_router_edge_idx();
         edge.set_bus_id(edge_.bus->id);
         edge.set_from_id(edge_.from->id);
         edge.set_to_id(edge_.to->id);
         edge.set_time(edge_.time);
         edge.set_span(edge_.span);
-        *router.add_router_edge_idx() = std::move(edge);
+        edge.set_type(static_cast<int>(edge_.type));
     }
 
     return true;
@@ -104,71 +244,218 @@ bool transport::Serial::SaveRouter(TransportRouter& router_,
 bool transport::Serial::SaveGraph(TransportRouter& router_,
                                   transport::serial::Graph& graph) {
 
+    graph.mutable_grath_edges()->Reserve(static_cast<int>(router_.graph_->edges_.size()));
     for(const auto& edge_ : router_.graph_->edges_) {
-        transport::serial::GraphEdge edge;
+        transport::serial::GraphEdge& edge = *graph.add_grath_edges();
         edge.set_from(edge_.from);
         edge.set_to(edge_.to);
         edge.set_weight(edge_.weight);
-        *graph.add_grath_edges() = std::move(edge);
-    }
-
-    for(const auto& list_ : router_.graph_->incidence_lists_) {
-        transport::serial::GraphIncidenceList list;
-        for(const auto& edge_id_ : list_) list.add_edge_ids(edge_id_);
-        *graph.add_grath_incidence_lists() = std::move(list);
-    }
-
-    for(const auto& routes_internal_data_ : router_.router_->routes_internal_data_) {
-        transport::serial::RoutesInternalData routes_internal_data;
-        for(const auto& route_internal_data_ : routes_internal_data_) {
-            transport::serial::RouteInternalData route_internal_data;
-            if(route_internal_data_ == std::nullopt) {
-                route_internal_data.set_weight(-1.0);
-            } else {
-                route_internal_data.set_weight(route_internal_data_->weight);
-                route_internal_data.set_prev_edge(
-                            route_internal_data_->prev_edge == std::nullopt ?
-                            -1 : route_internal_data_->prev_edge.value());
+    }
+
+    // incidence lists follow from the edges, see LoadGraph()
+    graph.set_vertex_count(router_.graph_->GetVertexCount());
+
+    if(const auto* ch = dynamic_cast<graph::ContractionHierarchy<double>*>(router_.router_.get())) {
+        SaveContractionHierarchy(*ch, *graph.mutable_contraction_hierarchy());
+    }
+
+    if(const auto* hub_labeling = dynamic_cast<graph::HubLabeling<double>*>(router_.router_.get())) {
+        SaveHubLabeling(*hub_labeling, *graph.mutable_hub_labeling());
+    }
+
+    graph.set_routes_version(ROUTES_VERSION);
+
+    return true;
+}
+
+bool transport::Serial::SaveTable(TransportRouter& router_, const RouteRowSink& sink) {
+
+    // only all-pairs engines have precomputed routes, in the weights of their tables
+    if(const auto* converted = dynamic_cast<graph::ConvertedRouter<float>*>(router_.router_.get())) {
+        return SaveTable(converted->GetEngine(), sink);
+    }
+    if(const auto* converted = dynamic_cast<graph::ConvertedRouter<uint32_t>*>(router_.router_.get())) {
+        return SaveTable(converted->GetEngine(), sink);
+    }
+    if(router_.router_) {
+        return SaveTable(*router_.router_, sink);
+    }
+    return true;
+}
+
+template <typename Weight>
+bool transport::Serial::SaveTable(const graph::RouterEngine<Weight>& engine,
+                                  const RouteRowSink& sink) {
+
+    if(const auto* all_pairs = dynamic_cast<const graph::Router<Weight>*>(&engine)) {
+        return SaveRoutes(*all_pairs, sink);
+    }
+    if(const auto* dense = dynamic_cast<const graph::DenseRouter<Weight>*>(&engine)) {
+        return SaveDenseRoutes(*dense, sink);
+    }
+    return true;
+}
+
+template <typename Weight>
+bool transport::Serial::SaveRoutes(const graph::Router<Weight>& all_pairs,
+                                   const RouteRowSink& sink) {
+
+    using Route = std::pair<Weight, std::optional<graph::EdgeId>>;
+
+    transport::serial::RouteRow row;
+    for(const auto& routes_internal_data_ : all_pairs.routes_internal_data_) {
+        row.Clear();
+        SaveRouteRow<Weight>(row, routes_internal_data_.size(),
+            [&routes_internal_data_](size_t to) {
+                const auto& route_internal_data_ = routes_internal_data_[to];
+                return route_internal_data_ ?
+                            std::optional<Route>({route_internal_data_->weight, route_internal_data_->prev_edge}) :
+                            std::nullopt;
+            });
+        sink(row);
+    }
+
+    return true;
+}
+
+bool transport::Serial::SaveContractionHierarchy(
+        const graph::ContractionHierarchy<double>& ch_,
+        transport::serial::ContractionHierarchy& ch) {
+
+    ch.mutable_ranks()->Reserve(static_cast<int>(ch_.ranks_.size()));
+    for(const auto rank_ : ch_.ranks_) ch.add_ranks(rank_);
+
+    ch.mutable_shortcuts()->Reserve(static_cast<int>(ch_.shortcuts_.size()));
+    for(const auto& shortcut_ : ch_.shortcuts_) {
+        transport::serial::ChShortcut& shortcut = *ch.add_shortcuts();
+        shortcut.set_from(shortcut_.from);
+        shortcut.set_to(shortcut_.to);
+        shortcut.set_weight(shortcut_.weight);
+        shortcut.set_first(shortcut_.first);
+        shortcut.set_second(shortcut_.second);
+    }
+
+    return true;
+}
+
+template <typename Weight>
+bool transport::Serial::SaveDenseRoutes(const graph::DenseRouter<Weight>& dense_,
+                                        const RouteRowSink& sink) {
+
+    using Route = std::pair<Weight, std::optional<graph::EdgeId>>;
+
+    // same rows as all-pairs Router
+    transport::serial::RouteRow row;
+    const size_t vertex_count = dense_.vertex_count_;
+    for(size_t from = 0; from < vertex_count; ++from) {
+        row.Clear();
+        SaveRouteRow<Weight>(row, vertex_count, [&dense_, from](size_t to) {
+            const size_t cell = dense_.Cell(from, to);
+            if(dense_.weights_data_[cell] == dense_.UNREACHABLE) {
+                return std::optional<Route>{};
             }
-            *routes_internal_data.add_route_internal_data() =
-                        std::move(route_internal_data);
-        }
-        *graph.add_routes_internal_data() = std::move(routes_internal_data);
+            const auto prev_edge = dense_.prev_edges_data_[cell];
+            return std::optional<Route>({dense_.weights_data_[cell],
+                                         prev_edge == dense_.NO_EDGE ? std::nullopt : std::optional<graph::EdgeId>(prev_edge)});
+        });
+        sink(row);
     }
 
     return true;
 }
 
+bool transport::Serial::SaveHubLabeling(const graph::HubLabeling<double>& hub_labeling_,
+                                        transport::serial::HubLabeling& hub_labeling) {
+
+    using HubLabeling = graph::HubLabeling<double>;
+
+    auto save = [](const HubLabeling::Labels& labels_, auto* labels) {
+        labels->Reserve(static_cast<int>(labels_.offsets.size()));
+        for(size_t vertex = 0; vertex + 1 < labels_.offsets.size(); ++vertex) {
+            transport::serial::HubLabel& label = *labels->Add();
+            label.mutable_entries()->Reserve(static_cast<int>(labels_.offsets[vertex + 1] - labels_.offsets[vertex]));
+            for(size_t i = labels_.offsets[vertex]; i < labels_.offsets[vertex + 1]; ++i) {
+                const auto& entry_ = labels_.entries[i];
+                transport::serial::HubLabelEntry& entry = *label.add_entries();
+                entry.set_hub(entry_.hub);
+                entry.set_weight(entry_.weight);
+                entry.set_edge(entry_.edge == HubLabeling::NO_EDGE ? -1 : static_cast<int>(entry_.edge));
+            }
+        }
+    };
+    save(hub_labeling_.out_labels_, hub_labeling.mutable_out_labels());
+    save(hub_labeling_.in_labels_, hub_labeling.mutable_in_labels());
+
+    return true;
+}
+
+bool transport::Serial::SaveMeta(renderer::RenderSettings& render_settings_,
+                                 TransportRouter& router_,
+                                 transport::serial::TransportCatalogue& meta) {
+
+    SaveRenderSettings(render_settings_, *meta.mutable_render_settings());
+    SaveRouterSettings(router_, *meta.mutable_router()->mutable_router_settings());
+
+    return true;
+}
+
 bool transport::Serial::SaveBase(std::string fname,
                                  TransportCatalogue& catalogue_,
                                  renderer::RenderSettings& render_settings_,
                                  TransportRouter& router_) {
 
-    transport::serial::TransportCatalogue base;
+    using mapped::SectionId;
+    using google::protobuf::Arena;
+    mapped::Writer writer(fname);
 
-    // CATALOGUE
-    transport::serial::Catalogue catalogue;
-    SaveCatalogue(catalogue_, catalogue);
-    *base.mutable_catalogue() = std::move(catalogue);
+    // messages of a section are made on its arena and dropped once the section is written
 
-    // RENDER_SETTINGS
-    transport::serial::RenderSettings render_settings;
-    SaveRenderSettings(render_settings_, render_settings);
-    *base.mutable_render_settings() = std::move(render_settings);
+    // META
+    {
+        Arena arena;
+        auto* meta = Arena::CreateMessage<transport::serial::TransportCatalogue>(&arena);
+        SaveMeta(render_settings_, router_, *meta);
+        writer.AddSection(SectionId::META, meta->SerializeAsString());
+    }
+
+    // CATALOGUE
+    {
+        Arena arena;
+        auto* catalogue = Arena::CreateMessage<transport::serial::Catalogue>(&arena);
+        SaveCatalogue(catalogue_, *catalogue);
+        writer.AddSection(SectionId::CATALOGUE, catalogue->SerializeAsString());
+    }
 
     // ROUTER
-    transport::serial::Router router;
-    SaveRouter(router_, router);
-    *base.mutable_router() = std::move(router);
+    {
+        Arena arena;
+        auto* router = Arena::CreateMessage<transport::serial::Router>(&arena);
+        SaveRouter(router_, *router);
+        writer.AddSection(SectionId::ROUTER, router->SerializeAsString());
+    }
 
     // GRAPH
-    transport::serial::Graph graph;
-    SaveGraph(router_, graph);
-    *base.mutable_graph() = std::move(graph);
+    {
+        Arena arena;
+        auto* graph = Arena::CreateMessage<transport::serial::Graph>(&arena);
+        SaveGraph(router_, *graph);
+        writer.BeginSection(SectionId::GRAPH);
+        writer.Append(graph->SerializeAsString());
+    }
 
-    std::ofstream out_file(fname, std::ios::binary);
-    base.SerializeToOstream(&out_file);
+    // the table row by row: serialized messages concatenate into their merge, so each chunk
+    // of a Graph with one row appends the row to route_rows of the section
+    transport::serial::Graph chunk;
+    chunk.add_route_rows();
+    std::string data;
+    SaveTable(router_, [&writer, &chunk, &data](transport::serial::RouteRow& row) {
+        chunk.mutable_route_rows(0)->Swap(&row);
+        chunk.SerializeToString(&data);
+        writer.Append(data);
+    });
+    writer.EndSection();
 
+    writer.Finish();
     return true;
 }
 
@@ -178,6 +465,11 @@ bool transport::Serial::LoadCatalogue(
         std::vector<transport::Stop*>& stops,
         std::vector<transport::Bus*>& buses) {
 
+    catalogue.stops_indx_.reserve(base.catalogue().stops_size());
+    catalogue.buses_indx_.reserve(base.catalogue().buses_size());
+    catalogue.distances_.reserve(base.catalogue().distances_size());
+    catalogue.stops_buses_indx_.reserve(base.catalogue().stop_buses_size());
+
     for(const auto& stop : base.mutable_catalogue()->stops()) {
         stops[stop.id()] = catalogue.AddStop(stop.name(), {stop.lat(), stop.lng()});
     }
@@ -222,6 +514,7 @@ bool transport::Serial::LoadRenderSettings(
     render_settings_.underlayer_color = render_settings.underlayer_color();
     render_settings_.underlayer_width = render_settings.underlayer_width();
     render_settings_.stroke_color.resize(0);
+    render_settings_.stroke_color.reserve(render_settings.stroke_color_size());
     for(auto& color : render_settings.stroke_color())
         render_settings_.stroke_color.push_back(color);
     render_settings_.fill_color = render_settings.fill_color();
@@ -233,24 +526,42 @@ bool transport::Serial::LoadRenderSettings(
     return true;
 }
 
+bool transport::Serial::LoadRouterSettings(const transport::serial::RouterSettings& router_settings,
+                                           TransportRouter& router_) {
+
+    router_.settings_.wait = router_settings.wait();
+    router_.settings_.velocity = router_settings.velocity();
+    router_.settings_.engine = static_cast<TransportRouter::Engine>(
+                router_settings.engine());
+    router_.settings_.tree_cache_bytes = router_settings.tree_cache_bytes();
+    router_.settings_.graph_model = static_cast<TransportRouter::GraphModel>(
+                router_settings.graph_model());
+    router_.settings_.stop_vertices_only = router_settings.stop_vertices_only();
+    router_.settings_.weight_type = static_cast<TransportRouter::WeightType>(
+                router_settings.weight_type());
+    router_.settings_.next_hops = router_settings.next_hops();
+    router_.settings_.route_cache_entries = router_settings.route_cache_entries();
+
+    return true;
+}
+
 bool transport::Serial::LoadRouter(transport::serial::TransportCatalogue& base,
                                    TransportRouter& router_,
                                    std::vector<transport::Stop*>& stops,
                                    std::vector<transport::Bus*>& buses) {
 
-    const auto& router_settings = base.router().router_settings();
-    router_.settings_.wait = router_settings.wait();
-    router_.settings_.velocity = router_settings.velocity();
-
-    router_.stops_.clear();
-    for(const auto& stop : base.router().router_stops()) {
-        router_.stops_.insert({stop.name(), stop.number()});
-    }
+    LoadRouterSettings(base.router().router_settings(), router_);
 
     router_.edges_.clear();
+    router_.edges_.reserve(base.router().router_edge_idx_size());
     for(const auto& edge : base.router().router_edge_idx()) {
+        TransportRouter::EdgeType type = edge.span() == 0 ? TransportRouter::EdgeType::WAIT
+                                                          : TransportRouter::EdgeType::BUS;
+        if(edge.has_type()) {
+            type = static_cast<TransportRouter::EdgeType>(edge.type());
+        }
         router_.edges_.push_back({buses[edge.bus_id()], stops[edge.from_id()],
-                                  stops[edge.to_id()], edge.time(), edge.span()});
+                                  stops[edge.to_id()], edge.time(), edge.span(), type});
     }
 
     return true;
@@ -259,74 +570,516 @@ bool transport::Serial::LoadRouter(transport::serial::TransportCatalogue& base,
 bool transport::Serial::LoadGraph(transport::serial::TransportCatalogue& base,
                                   TransportRouter& router_) {
 
-    router_.graph_->edges_.clear();
+    // same graph object, engines keep a reference to it
+    const size_t vertex_count = base.graph().vertex_count() != 0 ?
+                base.graph().vertex_count() : base.graph().grath_incidence_lists_size();
+    *router_.graph_ = graph::DirectedWeightedGraph<double>(vertex_count);
+    router_.graph_->edges_.reserve(base.graph().grath_edges_size());
     for(const auto& edge : base.graph().grath_edges()) {
-        router_.graph_->edges_.push_back({edge.from(), edge.to(), edge.weight()});
+        router_.graph_->AddEdge({edge.from(), edge.to(), edge.weight()});
     }
+    router_.graph_->Freeze();
+
+    return true;
+}
 
-    router_.graph_->incidence_lists_.clear();
-    for(const auto& list : base.graph().grath_incidence_lists()) {
-        std::vector<graph::EdgeId> list_;
-        for(const auto& edge_id : list.edge_ids()) list_.push_back(edge_id);
-        router_.graph_->incidence_lists_.push_back(std::move(list_));
+template <typename Weight>
+std::unique_ptr<graph::RouterEngine<Weight>> transport::Serial::LoadTable(
+        transport::serial::TransportCatalogue& base,
+        TransportRouter& router_,
+        const graph::DirectedWeightedGraph<Weight>& table_graph) {
+
+    if(router_.settings_.engine == TransportRouter::Engine::ALL_PAIRS_DENSE) {
+        return LoadDenseRoutes(base, table_graph);
     }
+    return LoadRoutes(base, table_graph, router_.settings_.next_hops);
+}
 
-    router_.router_->routes_internal_data_.clear();
-    for(const auto& routes_internal_data : base.graph().routes_internal_data()) {
+template <typename Weight>
+std::unique_ptr<graph::RouterEngine<Weight>> transport::Serial::LoadRoutes(
+        transport::serial::TransportCatalogue& base,
+        const graph::DirectedWeightedGraph<Weight>& table_graph,
+        bool next_hops) {
 
-        std::vector<std::optional<graph::Router<double>::RouteInternalData>> routes_internal_data_;
-        for(const auto& route_internal_data : routes_internal_data.route_internal_data()) {
+    using Router = graph::Router<Weight>;
 
-            std::optional<graph::Router<double>::RouteInternalData> route_internal_data_;
-            if(route_internal_data.weight() != -1.0) {
-                std::optional<graph::EdgeId> prev_edge;
-                if(route_internal_data.prev_edge() != -1) {
-                    prev_edge = route_internal_data.prev_edge();
-                }
-                route_internal_data_ = {route_internal_data.weight(), prev_edge};
+    // at() rejects cells outside the graph, the Router checks the rest
+    const size_t vertex_count = table_graph.GetVertexCount();
+    typename Router::RoutesInternalData routes_internal_data_(
+                vertex_count, std::vector<std::optional<typename Router::RouteInternalData>>(vertex_count));
+    LoadRouteCells<Weight>(base.graph(),
+        [&routes_internal_data_](size_t from, size_t to, Weight weight, std::optional<graph::EdgeId> prev_edge) {
+            routes_internal_data_.at(from).at(to) = typename Router::RouteInternalData{weight, prev_edge};
+        });
+
+    return std::make_unique<Router>(table_graph, std::move(routes_internal_data_), next_hops);
+}
+
+bool transport::Serial::LoadContractionHierarchy(
+        transport::serial::TransportCatalogue& base,
+        TransportRouter& router_) {
+
+    const auto& ch = base.graph().contraction_hierarchy();
+
+    std::vector<size_t> ranks(ch.ranks().begin(), ch.ranks().end());
+
+    std::vector<graph::ContractionHierarchy<double>::Shortcut> shortcuts;
+    shortcuts.reserve(ch.shortcuts_size());
+    for(const auto& shortcut : ch.shortcuts()) {
+        shortcuts.push_back({shortcut.from(), shortcut.to(), shortcut.weight(),
+                             shortcut.first(), shortcut.second()});
+    }
+
+    router_.router_ = std::make_unique<graph::ContractionHierarchy<double>>(
+                *router_.graph_, std::move(ranks), std::move(shortcuts));
+
+    return true;
+}
+
+bool transport::Serial::LoadHubLabeling(
+        transport::serial::TransportCatalogue& base,
+        TransportRouter& router_) {
+
+    using HubLabeling = graph::HubLabeling<double>;
+
+    auto load = [](const auto& labels) {
+        HubLabeling::Labels labels_;
+        size_t entry_count = 0;
+        for(const auto& label : labels) entry_count += label.entries_size();
+        labels_.entries.reserve(entry_count);
+        labels_.offsets.reserve(labels.size() + 1);
+        labels_.offsets.push_back(0);
+        for(const auto& label : labels) {
+            for(const auto& entry : label.entries()) {
+                labels_.entries.push_back({entry.hub(), entry.weight(),
+                                           entry.edge() < 0 ? HubLabeling::NO_EDGE
+                                                            : static_cast<graph::EdgeId>(entry.edge())});
             }
-            routes_internal_data_.push_back(std::move(route_internal_data_));
+            labels_.offsets.push_back(labels_.entries.size());
         }
-        router_.router_->routes_internal_data_.push_back(std::move(routes_internal_data_));
-    }
+        return labels_;
+    };
+
+    const auto& hub_labeling = base.graph().hub_labeling();
+    router_.router_ = std::make_unique<HubLabeling>(*router_.graph_,
+                                                    load(hub_labeling.out_labels()),
+                                                    load(hub_labeling.in_labels()));
 
     return true;
 }
 
+template <typename Weight>
+std::unique_ptr<graph::RouterEngine<Weight>> transport::Serial::LoadDenseRoutes(
+        transport::serial::TransportCatalogue& base,
+        const graph::DirectedWeightedGraph<Weight>& table_graph) {
+
+    using DenseRouter = graph::DenseRouter<Weight>;
+
+    const size_t vertex_count = table_graph.GetVertexCount();
+    std::vector<Weight> weights(vertex_count * vertex_count, DenseRouter::UNREACHABLE);
+    std::vector<typename DenseRouter::PrevEdge> prev_edges(vertex_count * vertex_count, DenseRouter::NO_EDGE);
+
+    LoadRouteCells<Weight>(base.graph(),
+        [&](size_t from, size_t to, Weight weight, std::optional<graph::EdgeId> prev_edge) {
+            if(from >= vertex_count || to >= vertex_count) {
+                throw std::out_of_range("Routes table doesn't match the graph");
+            }
+            const size_t cell = from * vertex_count + to;
+            weights[cell] = weight;
+            if(prev_edge) {
+                prev_edges[cell] = static_cast<typename DenseRouter::PrevEdge>(*prev_edge);
+            }
+        });
+
+    return std::make_unique<DenseRouter>(table_graph, std::move(weights), std::move(prev_edges));
+}
+
 bool transport::Serial::LoadBase(std::string fname,
                                  TransportCatalogue& catalogue_,
                                  renderer::RenderSettings& render_settings_,
                                  TransportRouter& router_) {
 
-    std::ifstream in_file(fname, std::ios::binary);
+    LazyBase base(fname, catalogue_, render_settings_, router_);
+    base.LoadRenderSettings();
+    base.LoadRouter();
+
+    return true;
+}
+
+bool transport::Serial::LoadRouting(transport::serial::TransportCatalogue& base,
+                                    TransportRouter& router_,
+                                    std::vector<transport::Stop*>& stops,
+                                    std::vector<transport::Bus*>& buses) {
 
-    transport::serial::TransportCatalogue base;
+    // ROUTER
+    LoadRouter(base, router_, stops, buses);
 
-    if (!base.ParseFromIstream(&in_file)) {
-        return false;
+    // GRAPH
+    router_.graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(2 * stops.size());
+    if(router_.settings_.engine == TransportRouter::Engine::ALL_PAIRS
+       || router_.settings_.engine == TransportRouter::Engine::ALL_PAIRS_DENSE) {
+        // the table is stored in the weights of settings, it's restored over the table graph
+        LoadGraph(base, router_);
+        if(router_.IsStopTable()) {
+            router_.FillStopGraph();
+        }
+        router_.router_ = router_.MakeTableRouter([&base, &router_](const auto& table_graph) {
+            return LoadTable(base, router_, table_graph);
+        });
+    } else if(router_.settings_.engine == TransportRouter::Engine::CONTRACTION_HIERARCHY) {
+        LoadGraph(base, router_);
+        LoadContractionHierarchy(base, router_);
+    } else if(router_.settings_.engine == TransportRouter::Engine::HUB_LABELING) {
+        LoadGraph(base, router_);
+        LoadHubLabeling(base, router_);
+    } else {
+        LoadGraph(base, router_);
+        router_.MakeRouter();
     }
 
-    std::vector<transport::Stop*> stops(base.mutable_catalogue()->stops_size());
-    std::vector<transport::Bus*> buses(base.mutable_catalogue()->buses_size());
+    return true;
+}
+
+template <typename Weight>
+void transport::Serial::SaveMappedTable(const graph::RouterEngine<Weight>& engine,
+                                        const TransportRouter& router_,
+                                        mapped::Writer& writer) {
+
+    using DenseRouter = graph::DenseRouter<Weight>;
+
+    const size_t vertex_count = router_.GetTableGraph().GetVertexCount();
+    const size_t cell_count = vertex_count * vertex_count;
+    writer.AddValue(mapped::SectionId::TABLE_INFO, mapped::TableInfo{
+                        vertex_count, static_cast<int32_t>(router_.settings_.weight_type), 0});
+
+    // the flat table of DenseRouter is written as it is
+    if(const auto* dense_ = dynamic_cast<const DenseRouter*>(&engine)) {
+        writer.AddSection(mapped::SectionId::TABLE_WEIGHTS,
+                          {reinterpret_cast<const char*>(dense_->weights_data_), cell_count * sizeof(Weight)});
+        writer.AddSection(mapped::SectionId::TABLE_PREV_EDGES,
+                          {reinterpret_cast<const char*>(dense_->prev_edges_data_),
+                           cell_count * sizeof(typename DenseRouter::PrevEdge)});
+        return;
+    }
+
+    const auto* all_pairs = dynamic_cast<const graph::Router<Weight>*>(&engine);
+    if(all_pairs == nullptr) {
+        return;
+    }
+    if(router_.GetTableGraph().GetEdgeCount() >= DenseRouter::NO_EDGE) {
+        throw std::length_error("Too many edges for 32-bit edge ids");
+    }
+    // flat rows one at a time
+    auto append_row = [&writer](const auto& row) {
+        writer.Append({reinterpret_cast<const char*>(row.data()), row.size() * sizeof(row[0])});
+    };
+
+    std::vector<Weight> weights(vertex_count);
+    writer.BeginSection(mapped::SectionId::TABLE_WEIGHTS);
+    for(const auto& routes_from : all_pairs->routes_internal_data_) {
+        for(size_t to = 0; to < vertex_count; ++to) {
+            weights[to] = routes_from[to] ? routes_from[to]->weight : DenseRouter::UNREACHABLE;
+        }
+        append_row(weights);
+    }
+    writer.EndSection();
+
+    std::vector<typename DenseRouter::PrevEdge> prev_edges(vertex_count);
+    writer.BeginSection(mapped::SectionId::TABLE_PREV_EDGES);
+    for(const auto& routes_from : all_pairs->routes_internal_data_) {
+        for(size_t to = 0; to < vertex_count; ++to) {
+            prev_edges[to] = routes_from[to] && routes_from[to]->prev_edge ?
+                        static_cast<typename DenseRouter::PrevEdge>(*routes_from[to]->prev_edge) : DenseRouter::NO_EDGE;
+        }
+        append_row(prev_edges);
+    }
+    writer.EndSection();
+}
+
+bool transport::Serial::SaveMappedBase(std::string fname,
+                                       TransportCatalogue& catalogue_,
+                                       renderer::RenderSettings& render_settings_,
+                                       TransportRouter& router_) {
+
+    using mapped::SectionId;
+    mapped::Writer writer(fname);
+
+    // META
+    transport::serial::TransportCatalogue meta;
+    SaveMeta(render_settings_, router_, meta);
+    writer.AddSection(SectionId::META, meta.SerializeAsString());
+
+    // CATALOGUE, ids are the indices (see AddStop(), AddBus())
+    std::string strings;
+    auto add_string = [&strings](std::string_view string) {
+        const mapped::String added{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(string.size())};
+        strings += string;
+        return added;
+    };
+
+    std::vector<mapped::Stop> stops;
+    stops.reserve(catalogue_.stops_.size());
+    for(const auto& stop_ : catalogue_.stops_) {
+        stops.push_back({add_string(stop_.name), stop_.coordinates.lat, stop_.coordinates.lng});
+    }
+
+    std::vector<mapped::Bus> buses;
+    std::vector<uint32_t> bus_stops;
+    buses.reserve(catalogue_.buses_.size());
+    for(const auto& bus_ : catalogue_.buses_) {
+        buses.push_back({add_string(bus_.name), static_cast<uint32_t>(bus_stops.size()),
+                         static_cast<uint32_t>(bus_.stops.size()),
+                         bus_.last_stop == nullptr ? -1 : bus_.last_stop->id, 0});
+        for(const auto* stop : bus_.stops) bus_stops.push_back(stop->id);
+    }
+
+    std::vector<mapped::Distance> distances;
+    distances.reserve(catalogue_.distances_.size());
+    for(const auto& [key, val] : catalogue_.distances_) {
+        distances.push_back({static_cast<uint32_t>(key.from_ptr->id), static_cast<uint32_t>(key.to_ptr->id), val});
+    }
+
+    writer.AddSection(SectionId::STRINGS, std::move(strings));
+    writer.AddArray(SectionId::STOPS, stops);
+    writer.AddArray(SectionId::BUSES, buses);
+    writer.AddArray(SectionId::BUS_STOPS, bus_stops);
+    writer.AddArray(SectionId::DISTANCES, distances);
+
+    // ROUTER
+    std::vector<mapped::RouterEdge> router_edges;
+    router_edges.reserve(router_.edges_.size());
+    for(const auto& edge_ : router_.edges_) {
+        router_edges.push_back({static_cast<uint32_t>(edge_.bus->id), static_cast<uint32_t>(edge_.from->id),
+                                static_cast<uint32_t>(edge_.to->id), static_cast<uint32_t>(edge_.span),
+                                static_cast<int32_t>(edge_.type), 0, edge_.time});
+    }
+    writer.AddArray(SectionId::ROUTER_EDGES, router_edges);
+
+    // GRAPH
+    const auto& graph_ = *router_.graph_;
+    if(graph_.GetVertexCount() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many vertices for 32-bit vertex ids");
+    }
+    std::vector<mapped::GraphEdge> graph_edges;
+    graph_edges.reserve(graph_.edges_.size());
+    for(const auto& edge_ : graph_.edges_) {
+        graph_edges.push_back({static_cast<uint32_t>(edge_.from), static_cast<uint32_t>(edge_.to), edge_.weight});
+    }
+    writer.AddArray(SectionId::GRAPH_EDGES, graph_edges);
+    writer.AddValue(SectionId::GRAPH_INFO, mapped::GraphInfo{graph_.GetVertexCount()});
+
+    // CH and hub labels stay protobuf
+    {
+        google::protobuf::Arena arena;
+        auto& graph = *google::protobuf::Arena::CreateMessage<transport::serial::Graph>(&arena);
+        if(const auto* ch = dynamic_cast<graph::ContractionHierarchy<double>*>(router_.router_.get())) {
+            SaveContractionHierarchy(*ch, *graph.mutable_contraction_hierarchy());
+        }
+        if(const auto* hub_labeling = dynamic_cast<graph::HubLabeling<double>*>(router_.router_.get())) {
+            SaveHubLabeling(*hub_labeling, *graph.mutable_hub_labeling());
+        }
+        writer.AddSection(SectionId::GRAPH, graph.SerializeAsString());
+    }
+
+    // TABLE, only all-pairs engines have one
+    if(const auto* converted = dynamic_cast<graph::ConvertedRouter<float>*>(router_.router_.get())) {
+        SaveMappedTable(converted->GetEngine(), router_, writer);
+    } else if(const auto* converted = dynamic_cast<graph::ConvertedRouter<uint32_t>*>(router_.router_.get())) {
+        SaveMappedTable(converted->GetEngine(), router_, writer);
+    } else if(router_.router_) {
+        SaveMappedTable(*router_.router_, router_, writer);
+    }
+
+    writer.Finish();
+    return true;
+}
+
+template <typename Weight>
+std::unique_ptr<graph::RouterEngine<Weight>> transport::Serial::LoadMappedTable(
+        const mapped::File& file,
+        const TransportRouter& router_,
+        const graph::DirectedWeightedGraph<Weight>& table_graph) {
+
+    using mapped::SectionId;
+    using DenseRouter = graph::DenseRouter<Weight>;
+
+    const auto& info = file.GetValue<mapped::TableInfo>(SectionId::TABLE_INFO);
+    const size_t cell_count = table_graph.GetVertexCount() * table_graph.GetVertexCount();
+    size_t weight_count = 0;
+    size_t prev_edge_count = 0;
+    const auto* weights = file.GetArray<Weight>(SectionId::TABLE_WEIGHTS, weight_count);
+    const auto* prev_edges = file.GetArray<typename DenseRouter::PrevEdge>(SectionId::TABLE_PREV_EDGES,
+                                                                           prev_edge_count);
+    if(info.vertex_count != table_graph.GetVertexCount()
+       || info.weight_type != static_cast<int32_t>(router_.settings_.weight_type)
+       || weight_count != cell_count || prev_edge_count != cell_count) {
+        throw std::runtime_error("Mapped base file is corrupted");
+    }
+    return std::make_unique<DenseRouter>(table_graph, weights, prev_edges);
+}
+
+bool transport::Serial::LoadSectionedCatalogue(const mapped::File& file,
+                                               TransportCatalogue& catalogue_,
+                                               std::vector<transport::Stop*>& stops,
+                                               std::vector<transport::Bus*>& buses) {
+
+    using mapped::SectionId;
+
+    if(file.GetSectionVersion(SectionId::CATALOGUE) != 0) {
+        google::protobuf::Arena arena;
+        auto& base = *google::protobuf::Arena::CreateMessage<transport::serial::TransportCatalogue>(&arena);
+        ParseSection(file, SectionId::CATALOGUE, *base.mutable_catalogue());
+        stops.assign(base.catalogue().stops_size(), nullptr);
+        buses.assign(base.catalogue().buses_size(), nullptr);
+        TransportCatalogue catalogue;
+        LoadCatalogue(base, catalogue, stops, buses);
+        catalogue_ = std::move(catalogue);
+        return true;
+    }
+
+    // fixed layout, ids are the indices (see AddStop(), AddBus())
+    size_t stop_count = 0, bus_count = 0, bus_stop_count = 0, distance_count = 0;
+    const auto* stops_ = file.GetArray<mapped::Stop>(SectionId::STOPS, stop_count);
+    const auto* buses_ = file.GetArray<mapped::Bus>(SectionId::BUSES, bus_count);
+    const auto* bus_stops_ = file.GetArray<uint32_t>(SectionId::BUS_STOPS, bus_stop_count);
+    const auto* distances_ = file.GetArray<mapped::Distance>(SectionId::DISTANCES, distance_count);
 
-    // CATALOGUE
     TransportCatalogue catalogue;
-    LoadCatalogue(base, catalogue, stops, buses);
+    stops.assign(stop_count, nullptr);
+    buses.assign(bus_count, nullptr);
+    for(size_t id = 0; id < stop_count; ++id) {
+        stops[id] = catalogue.AddStop(file.GetString(stops_[id].name), {stops_[id].lat, stops_[id].lng});
+    }
+    for(size_t i = 0; i < distance_count; ++i) {
+        catalogue.SetDistance(stops.at(distances_[i].from), stops.at(distances_[i].to), distances_[i].val);
+    }
+    for(size_t id = 0; id < bus_count; ++id) {
+        const auto& bus = buses_[id];
+        if(bus.first_stop > bus_stop_count || bus.stop_count > bus_stop_count - bus.first_stop) {
+            throw std::runtime_error("Mapped base file is corrupted");
+        }
+        std::deque<Stop*> bus_stops;
+        for(size_t i = bus.first_stop; i < bus.first_stop + bus.stop_count; ++i) bus_stops.push_back(stops.at(bus_stops_[i]));
+        buses[id] = catalogue.AddBus(file.GetString(bus.name), std::move(bus_stops),
+                                     bus.last_stop == -1 ? nullptr : stops.at(bus.last_stop));
+    }
     catalogue_ = std::move(catalogue);
 
-    // RENDER_SETTINGS
-    renderer::RenderSettings render_settings;
-    LoadRenderSettings(base, render_settings);
-    render_settings_ = std::move(render_settings);
+    return true;
+}
+
+bool transport::Serial::LoadSectionedRouting(const std::shared_ptr<const mapped::File>& file,
+                                             const transport::serial::TransportCatalogue& meta,
+                                             TransportRouter& router_,
+                                             std::vector<transport::Stop*>& stops,
+                                             std::vector<transport::Bus*>& buses) {
+
+    using mapped::SectionId;
+
+    google::protobuf::Arena arena;
+    auto& base = *google::protobuf::Arena::CreateMessage<transport::serial::TransportCatalogue>(&arena);
+    if(file->GetSectionVersion(SectionId::ROUTER) != 0) {
+        ParseSection(*file, SectionId::ROUTER, *base.mutable_router());
+        ParseSection(*file, SectionId::GRAPH, *base.mutable_graph());
+        return LoadRouting(base, router_, stops, buses);
+    }
+
+    // fixed layout; CH and hub labels are in GRAPH, in META of the bases before it
+    if(file->GetSectionVersion(SectionId::GRAPH) != 0) {
+        ParseSection(*file, SectionId::GRAPH, *base.mutable_graph());
+    } else {
+        *base.mutable_graph() = meta.graph();
+    }
 
     // ROUTER
-    LoadRouter(base, router_, stops, buses);
+    LoadRouterSettings(meta.router().router_settings(), router_);
+    size_t router_edge_count = 0;
+    const auto* router_edges = file->GetArray<mapped::RouterEdge>(SectionId::ROUTER_EDGES, router_edge_count);
+    router_.edges_.clear();
+    router_.edges_.reserve(router_edge_count);
+    for(size_t id = 0; id < router_edge_count; ++id) {
+        const auto& edge = router_edges[id];
+        router_.edges_.push_back({buses.at(edge.bus), stops.at(edge.from), stops.at(edge.to),
+                                  edge.time, edge.span, static_cast<TransportRouter::EdgeType>(edge.type)});
+    }
 
     // GRAPH
-    router_.graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(2 * catalogue_.GetStops().size());
-    router_.router_ = std::make_unique<graph::Router<double>>(*router_.graph_);
+    size_t graph_edge_count = 0;
+    const auto* graph_edges = file->GetArray<mapped::GraphEdge>(SectionId::GRAPH_EDGES, graph_edge_count);
+    const size_t vertex_count = file->GetValue<mapped::GraphInfo>(SectionId::GRAPH_INFO).vertex_count;
+    router_.graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(vertex_count);
+    router_.graph_->edges_.reserve(graph_edge_count);
+    for(size_t id = 0; id < graph_edge_count; ++id) {
+        const auto& edge = graph_edges[id];
+        if(edge.from >= vertex_count || edge.to >= vertex_count) {
+            throw std::runtime_error("Mapped base file is corrupted");
+        }
+        router_.graph_->AddEdge({edge.from, edge.to, edge.weight});
+    }
+    router_.graph_->Freeze();
 
-    LoadGraph(base, router_);
+    if(router_.settings_.engine == TransportRouter::Engine::ALL_PAIRS
+       || router_.settings_.engine == TransportRouter::Engine::ALL_PAIRS_DENSE) {
+        if(router_.IsStopTable()) {
+            router_.FillStopGraph();
+        }
+        router_.router_ = router_.MakeTableRouter([&file, &router_](const auto& table_graph) {
+            return LoadMappedTable(*file, router_, table_graph);
+        });
+    } else if(router_.settings_.engine == TransportRouter::Engine::CONTRACTION_HIERARCHY) {
+        LoadContractionHierarchy(base, router_);
+    } else if(router_.settings_.engine == TransportRouter::Engine::HUB_LABELING) {
+        LoadHubLabeling(base, router_);
+    } else {
+        router_.MakeRouter();
+    }
+    router_.base_file_ = file;
 
     return true;
 }
+
+transport::LazyBase::LazyBase(const std::string& fname,
+                              TransportCatalogue& catalogue,
+                              renderer::RenderSettings& render_settings,
+                              TransportRouter& router)
+    : render_settings_(render_settings)
+    , router_(router)
+{
+    if(mapped::File::IsMapped(fname)) {
+        file_ = std::make_shared<const mapped::File>(fname);
+        ParseSection(*file_, mapped::SectionId::META, base_);
+        Serial::LoadSectionedCatalogue(*file_, catalogue, stops_, buses_);
+        return;
+    }
+
+    std::ifstream in_file(fname, std::ios::binary);
+    if(!base_.ParseFromIstream(&in_file)) {
+        throw std::runtime_error("Can't read the base file " + fname);
+    }
+    stops_.resize(base_.catalogue().stops_size());
+    buses_.resize(base_.catalogue().buses_size());
+    TransportCatalogue catalogue_;
+    Serial::LoadCatalogue(base_, catalogue_, stops_, buses_);
+    catalogue = std::move(catalogue_);
+    base_.clear_catalogue();
+}
+
+void transport::LazyBase::LoadRenderSettings() {
+    if(render_settings_loaded_) return;
+    renderer::RenderSettings render_settings;
+    Serial::LoadRenderSettings(base_, render_settings);
+    render_settings_ = std::move(render_settings);
+    render_settings_loaded_ = true;
+}
+
+void transport::LazyBase::LoadRouter() {
+    if(router_loaded_) return;
+    if(file_) {
+        Serial::LoadSectionedRouting(file_, base_, router_, stops_, buses_);
+    } else {
+        Serial::LoadRouting(base_, router_, stops_, buses_);
+        base_.clear_router();
+        base_.clear_graph();
+    }
+    router_loaded_ = true;
+}
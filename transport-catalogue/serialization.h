@@ -9,8 +9,23 @@
 #include <transport_catalogue.pb.h>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <vector>
 
+namespace graph {
+    template <typename Weight>
+    class ContractionHierarchy;
+
+    template <typename Weight>
+    class DenseRouter;
+}
+
+namespace mapped {
+    class Writer;
+    class File;
+}
+
 namespace transport {
 
 class TransportCatalogue;
@@ -18,15 +33,45 @@ class TransportRouter;
 
 struct Serial {
 
+    // rows of the all-pairs table are passed one by one and may be taken (Swap) by the sink
+    using RouteRowSink = std::function<void(transport::serial::RouteRow&)>;
+
     static bool SaveCatalogue(TransportCatalogue&, transport::serial::Catalogue&);
 
     static bool SaveRenderSettings(renderer::RenderSettings&,
                                    transport::serial::RenderSettings&);
 
+    static bool SaveRouterSettings(TransportRouter&, transport::serial::RouterSettings&);
+
     static bool SaveRouter(TransportRouter&, transport::serial::Router&);
 
+    // edges, CH and hub labels; the rows of the table go by SaveTable()
     static bool SaveGraph(TransportRouter&, transport::serial::Graph&);
 
+    static bool SaveContractionHierarchy(const graph::ContractionHierarchy<double>&,
+                                         transport::serial::ContractionHierarchy&);
+
+    // ALL_PAIRS or ALL_PAIRS_DENSE table in any weights, see TransportRouter::WeightType
+    static bool SaveTable(TransportRouter&, const RouteRowSink&);
+
+    template <typename Weight>
+    static bool SaveTable(const graph::RouterEngine<Weight>&, const RouteRowSink&);
+
+    template <typename Weight>
+    static bool SaveRoutes(const graph::Router<Weight>&, const RouteRowSink&);
+
+    template <typename Weight>
+    static bool SaveDenseRoutes(const graph::DenseRouter<Weight>&, const RouteRowSink&);
+
+    static bool SaveHubLabeling(const graph::HubLabeling<double>&,
+                                transport::serial::HubLabeling&);
+
+    // META section: render and router settings
+    static bool SaveMeta(renderer::RenderSettings&, TransportRouter&,
+                         transport::serial::TransportCatalogue&);
+
+    // sections of protobuf messages (see mapped_base.h): META, CATALOGUE, ROUTER, GRAPH.
+    // Sections are written as they are made, the rows of the table one by one
     static bool SaveBase(std::string fname, TransportCatalogue&,
                          renderer::RenderSettings&, TransportRouter&);
 
@@ -38,6 +83,8 @@ struct Serial {
     static bool LoadRenderSettings(transport::serial::TransportCatalogue&,
                                    renderer::RenderSettings&);
 
+    static bool LoadRouterSettings(const transport::serial::RouterSettings&, TransportRouter&);
+
     static bool LoadRouter(transport::serial::TransportCatalogue&,
                            TransportRouter&,
                            std::vector<transport::Stop*>&,
@@ -46,8 +93,93 @@ struct Serial {
     static bool LoadGraph(transport::serial::TransportCatalogue&,
                           TransportRouter&);
 
+    static bool LoadContractionHierarchy(transport::serial::TransportCatalogue&,
+                                         TransportRouter&);
+
+    // engine of the table over the graph in its weights
+    template <typename Weight>
+    static std::unique_ptr<graph::RouterEngine<Weight>> LoadTable(transport::serial::TransportCatalogue&,
+                                                                  TransportRouter&,
+                                                                  const graph::DirectedWeightedGraph<Weight>&);
+
+    // next hops aren't stored, they are computed from the loaded table
+    template <typename Weight>
+    static std::unique_ptr<graph::RouterEngine<Weight>> LoadRoutes(transport::serial::TransportCatalogue&,
+                                                                   const graph::DirectedWeightedGraph<Weight>&,
+                                                                   bool next_hops);
+
+    template <typename Weight>
+    static std::unique_ptr<graph::RouterEngine<Weight>> LoadDenseRoutes(transport::serial::TransportCatalogue&,
+                                                                        const graph::DirectedWeightedGraph<Weight>&);
+
+    static bool LoadHubLabeling(transport::serial::TransportCatalogue&,
+                                TransportRouter&);
+
+    // router and graph of a parsed base: settings, edges and the engine
+    static bool LoadRouting(transport::serial::TransportCatalogue&,
+                            TransportRouter&,
+                            std::vector<transport::Stop*>&,
+                            std::vector<transport::Bus*>&);
+
+    // all parts at once, see LazyBase
     static bool LoadBase(std::string fname, TransportCatalogue&,
                          renderer::RenderSettings&, TransportRouter&);
+
+    // sections of fixed layout, see mapped_base.h: the catalogue, the graph and the table
+    // are plain arrays, the small rest is in protobuf META and GRAPH sections
+    static bool SaveMappedBase(std::string fname, TransportCatalogue&,
+                               renderer::RenderSettings&, TransportRouter&);
+
+    // catalogue of a sectioned base, protobuf or fixed layout
+    static bool LoadSectionedCatalogue(const mapped::File&,
+                                       TransportCatalogue&,
+                                       std::vector<transport::Stop*>&,
+                                       std::vector<transport::Bus*>&);
+
+    // router of a sectioned base with META parsed. A fixed-layout table of ALL_PAIRS and
+    // ALL_PAIRS_DENSE is read in place by DenseRouter (same answers), the router keeps the file mapped
+    static bool LoadSectionedRouting(const std::shared_ptr<const mapped::File>&,
+                                     const transport::serial::TransportCatalogue& meta,
+                                     TransportRouter&,
+                                     std::vector<transport::Stop*>&,
+                                     std::vector<transport::Bus*>&);
+
+    // the table in the weights of router settings, ALL_PAIRS row by row
+    template <typename Weight>
+    static void SaveMappedTable(const graph::RouterEngine<Weight>&, const TransportRouter&,
+                                mapped::Writer&);
+
+    template <typename Weight>
+    static std::unique_ptr<graph::RouterEngine<Weight>> LoadMappedTable(const mapped::File&,
+                                                                        const TransportRouter&,
+                                                                        const graph::DirectedWeightedGraph<Weight>&);
+};
+
+// Base opened by process_requests: the catalogue is loaded on open, render settings and
+// the router (graph, engine, table) on their first use. Sectioned bases read only the sections
+// of the loaded parts, old single-message bases are parsed whole on open
+class LazyBase {
+public:
+    // throws std::runtime_error if the file can't be read as a base
+    LazyBase(const std::string& fname, TransportCatalogue& catalogue,
+             renderer::RenderSettings& render_settings, TransportRouter& router);
+
+    // no-ops after the first call
+    void LoadRenderSettings();
+
+    void LoadRouter();
+
+private:
+    renderer::RenderSettings& render_settings_;
+    TransportRouter& router_;
+    std::shared_ptr<const mapped::File> file_;  // sectioned bases
+    // META of sectioned bases, the parts not loaded yet of the old ones
+    transport::serial::TransportCatalogue base_;
+    // ids of the base
+    std::vector<transport::Stop*> stops_;
+    std::vector<transport::Bus*> buses_;
+    bool render_settings_loaded_ = false;
+    bool router_loaded_ = false;
 };
 
 } //namespace transport
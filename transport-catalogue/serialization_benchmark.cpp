@@ -0,0 +1,171 @@
+// Save and load of the protobuf base on a synthetic city: wall time and the number of
+// operator new calls (protobuf messages, strings, containers of the catalogue and the router).
+// The graph-only engine shows the catalogue and graph paths, the dense table adds its rows.
+// Usage: serialization_benchmark [stop_count ...]
+
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* data = std::malloc(size != 0 ? size : 1)) {
+        return data;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* data) noexcept {
+    std::free(data);
+}
+
+void operator delete[](void* data) noexcept {
+    std::free(data);
+}
+
+void operator delete(void* data, size_t) noexcept {
+    std::free(data);
+}
+
+void operator delete[](void* data, size_t) noexcept {
+    std::free(data);
+}
+
+namespace {
+
+constexpr size_t STOPS_PER_BUS = 12;
+constexpr int REPEAT_COUNT = 3;
+
+// round-trip buses over near ids, distances between their consecutive stops
+void FillCatalogue(transport::TransportCatalogue& catalogue, size_t stop_count, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> coordinate(0.0, 0.2);
+    std::uniform_int_distribution<size_t> stop(0, stop_count - 1);
+    std::uniform_int_distribution<size_t> step(1, 3);
+    std::uniform_int_distribution<int> distance(300, 3000);
+
+    std::vector<transport::Stop*> stops;
+    stops.reserve(stop_count);
+    for (size_t i = 0; i < stop_count; ++i) {
+        stops.push_back(catalogue.AddStop("Stop "s + std::to_string(i),
+                                          {43.5 + coordinate(generator), 39.6 + coordinate(generator)}));
+    }
+
+    for (size_t i = 0; i < stop_count / 4; ++i) {
+        const size_t first = stop(generator);
+        const size_t bus_step = step(generator);
+        std::deque<transport::Stop*> bus_stops;
+        for (size_t k = 0; k < STOPS_PER_BUS; ++k) {
+            bus_stops.push_back(stops[(first + k * bus_step) % stop_count]);
+        }
+        bus_stops.push_back(bus_stops.front());
+        for (size_t k = 0; k + 1 < bus_stops.size(); ++k) {
+            catalogue.SetDistance(bus_stops[k], bus_stops[k + 1], distance(generator));
+        }
+        catalogue.AddBus("Bus "s + std::to_string(i), std::move(bus_stops));
+    }
+}
+
+struct Measure {
+    double seconds = 0.0;
+    size_t allocations = 0;
+};
+
+template <typename Action>
+Measure Run(Action action) {
+    Measure best;
+    for (int i = 0; i < REPEAT_COUNT; ++i) {
+        const size_t allocations = allocation_count.load();
+        const auto start = std::chrono::steady_clock::now();
+        action();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < best.seconds) {
+            best.seconds = seconds;
+        }
+        best.allocations = allocation_count.load() - allocations;
+    }
+    return best;
+}
+
+void Run(const std::string& name, size_t stop_count, transport::TransportRouter::Engine engine) {
+    const std::string fname = "serialization_benchmark.db"s;
+
+    transport::TransportCatalogue catalogue;
+    FillCatalogue(catalogue, stop_count, static_cast<unsigned>(stop_count));
+    renderer::RenderSettings render_settings;
+    transport::TransportRouter router(catalogue);
+    transport::TransportRouter::Settings settings;
+    settings.wait = 6.0;
+    settings.velocity = 40.0;
+    settings.engine = engine;
+    router.Init(settings);
+
+    const Measure save = Run([&] {
+        transport::Serial::SaveBase(fname, catalogue, render_settings, router);
+    });
+
+    size_t loaded_stops = 0;
+    const Measure load = Run([&] {
+        transport::TransportCatalogue loaded_catalogue;
+        renderer::RenderSettings loaded_render_settings;
+        transport::TransportRouter loaded_router(loaded_catalogue);
+        transport::Serial::LoadBase(fname, loaded_catalogue, loaded_render_settings, loaded_router);
+        loaded_stops = loaded_catalogue.GetStops().size();
+    });
+
+    std::ifstream file(fname, std::ios::binary | std::ios::ate);
+    const double file_bytes = static_cast<double>(file.tellg());
+    file.close();
+    std::remove(fname.c_str());
+
+    std::cout << std::left << std::setw(18) << name << std::right
+              << std::setw(8) << loaded_stops
+              << std::setw(11) << std::fixed << std::setprecision(4) << save.seconds
+              << std::setw(13) << save.allocations
+              << std::setw(11) << std::setprecision(4) << load.seconds
+              << std::setw(13) << load.allocations
+              << std::setw(11) << std::setprecision(2) << file_bytes / 1048576.0 << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes{1000, 4000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; ++i) {
+            sizes.push_back(std::stoul(argv[i]));
+        }
+    }
+
+    std::cout << "engine               stops    save, s  save allocs    load, s  load allocs  file, MiB\n"sv;
+    for (const size_t stop_count : sizes) {
+        Run("dijkstra"s, stop_count, transport::TransportRouter::Engine::DIJKSTRA);
+        Run("all_pairs_dense"s, stop_count, transport::TransportRouter::Engine::ALL_PAIRS_DENSE);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "graph.h"
+#include "weight_traits.h"
+
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// complete single-source tree: weight and last edge of the route to every vertex
+template <typename Weight>
+struct ShortestPathTree {
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    std::vector<std::optional<Weight>> weights;
+    std::vector<EdgeId> prev_edges;
+};
+
+// what a search does after it settles a vertex
+enum class SettleAction {
+    RELAX,  // go on through the vertex
+    STOP,   // the search is done
+};
+
+// Dijkstra over a frozen graph from `from` into `tree`. on_settle(vertex, weight) sees the vertices
+// in the order they are settled, after STOP the rest of the tree is partial. Routes heavier than
+// max_weight are never queued. Sums saturate like the tables (WeightTraits), so a fixed-point
+// route which reaches UNREACHABLE is no route. Returns the number of settled vertices
+template <typename Weight, typename OnSettle>
+size_t SearchShortestPathTree(const DirectedWeightedGraph<Weight>& graph, VertexId from,
+                              ShortestPathTree<Weight>& tree, OnSettle on_settle,
+                              std::optional<Weight> max_weight = std::nullopt) {
+    using QueueItem = std::pair<Weight, VertexId>;
+    const size_t vertex_count = graph.GetVertexCount();
+    if (from >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    tree.weights.assign(vertex_count, std::nullopt);
+    tree.prev_edges.assign(vertex_count, ShortestPathTree<Weight>::NO_EDGE);
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    tree.weights[from] = Weight{};
+    queue.push({Weight{}, from});
+    size_t settled_count = 0;
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > *tree.weights[vertex]) {
+            continue;  // stale item
+        }
+        ++settled_count;
+        if (on_settle(vertex, weight) == SettleAction::STOP) {
+            break;
+        }
+        // linear scan of the CSR row, edge ids go in parallel
+        auto incident_edge = graph.GetIncidentEdges(vertex).begin();
+        for (const auto& edge : graph.GetAdjacentEdges(vertex)) {
+            const EdgeId edge_id = *incident_edge++;
+            const Weight candidate_weight = WeightTraits<Weight>::Add(weight, edge.weight);
+            if (candidate_weight == WeightTraits<Weight>::UNREACHABLE) {
+                continue;
+            }
+            if (max_weight && candidate_weight > *max_weight) {
+                continue;  // beyond the budget, never settled
+            }
+            auto& route_weight = tree.weights[edge.to];
+            if (!route_weight || candidate_weight < *route_weight) {
+                route_weight = candidate_weight;
+                tree.prev_edges[edge.to] = edge_id;
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+    return settled_count;
+}
+
+// complete tree, f.e. to repair one row of an all-pairs table
+template <typename Weight>
+ShortestPathTree<Weight> BuildShortestPathTree(const DirectedWeightedGraph<Weight>& graph, VertexId from) {
+    ShortestPathTree<Weight> tree;
+    SearchShortestPathTree(graph, from, tree, [](VertexId, Weight) { return SettleAction::RELAX; });
+    return tree;
+}
+
+// whether a shortest-path tree (f.e. a row of an all-pairs table) may change after the edits
+// of `changed_edges`: the route to edge.to ends with the edge (its weight changed or it is
+// removed) or a present edge shortens a route. `weight(to)` and `prev_edge(to)` read the tree,
+// std::nullopt for no route / no edge. Untouched trees stay exact
+template <typename Weight, typename TreeWeight, typename TreePrevEdge>
+bool IsTreeAffected(const DirectedWeightedGraph<Weight>& graph, const std::vector<EdgeId>& changed_edges,
+                    TreeWeight weight, TreePrevEdge prev_edge) {
+    for (const EdgeId edge_id : changed_edges) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (prev_edge(edge.to) == std::optional<EdgeId>(edge_id)) {
+            return true;
+        }
+        if (!graph.HasEdge(edge_id)) {
+            continue;
+        }
+        const std::optional<Weight> weight_from = weight(edge.from);
+        if (!weight_from) {
+            continue;
+        }
+        const Weight candidate_weight = WeightTraits<Weight>::Add(*weight_from, edge.weight);
+        const std::optional<Weight> weight_to = weight(edge.to);
+        if (candidate_weight != WeightTraits<Weight>::UNREACHABLE
+            && (!weight_to || candidate_weight < *weight_to)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace graph
@@ -0,0 +1,89 @@
+// Loads baseline_base.db, a base written by the code before the routing engines were added
+// (input: baseline_make_base.json), and compares the answers to baseline_requests.json with
+// baseline_answers.json, the answers of that code. Runs in the tests directory.
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+// line endings of the expected file don't matter
+std::string ReadText(const std::string& fname) {
+    std::ifstream file(fname, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Can't read "s + fname);
+    }
+    std::string text{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    std::string result;
+    result.reserve(text.size());
+    for (const char c : text) {
+        if (c != '\r') {
+            result.push_back(c);
+        }
+    }
+    while (!result.empty() && result.back() == '\n') {
+        result.pop_back();
+    }
+    return result;
+}
+
+std::string ProcessRequests(const std::string& fname) {
+    std::ifstream requests(fname);
+    transport::TransportCatalogue catalogue;
+    renderer::MapRenderer renderer;
+    transport::TransportRouter router(catalogue);
+    transport::RequestHandler request_handler(catalogue, renderer, router);
+    transport::JsonReader jreader(catalogue, json::Load(requests).GetRoot(), request_handler);
+
+    // ExecQueries prints the answers to std::cout
+    std::ostringstream answers;
+    std::streambuf* cout_buf = std::cout.rdbuf(answers.rdbuf());
+    try {
+        jreader.BaseLoad(router);
+        jreader.ExecQueries();
+    } catch (...) {
+        std::cout.rdbuf(cout_buf);
+        throw;
+    }
+    std::cout.rdbuf(cout_buf);
+
+    std::string result = answers.str();
+    while (!result.empty() && result.back() == '\n') {
+        result.pop_back();
+    }
+    return result;
+}
+
+}  // namespace
+
+int main() {
+    const std::string expected = ReadText("baseline_answers.json"s);
+    const std::string answers = ProcessRequests("baseline_requests.json"s);
+    if (answers == expected) {
+        std::cout << "baseline base: answers match\n"sv;
+        return EXIT_SUCCESS;
+    }
+
+    size_t line = 1;
+    size_t pos = 0;
+    for (; pos < answers.size() && pos < expected.size() && answers[pos] == expected[pos]; ++pos) {
+        if (answers[pos] == '\n') {
+            ++line;
+        }
+    }
+    std::cerr << "baseline base: answers differ at line "sv << line << '\n';
+    return EXIT_FAILURE;
+}
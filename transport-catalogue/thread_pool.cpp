@@ -0,0 +1,82 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace concurrency {
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+        workers_.emplace_back([this, i] { Work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t task_count, const std::function<void(size_t)>& task) {
+    if (workers_.empty() || task_count < 2) {
+        for (size_t i = 0; i < task_count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        task_ = &task;
+        task_count_ = task_count;
+        next_task_ = 0;
+        loop_threads_ = std::min(task_count, GetThreadCount());
+        busy_workers_ = loop_threads_ - 1;
+        ++generation_;
+    }
+    start_.notify_all();
+    RunTasks();
+
+    std::unique_lock lock(mutex_);
+    finish_.wait(lock, [this] { return busy_workers_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::Work(size_t index) {
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            start_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+            if (stop_) {
+                return;
+            }
+            seen_generation = generation_;
+            if (index >= loop_threads_) {
+                continue;
+            }
+        }
+        RunTasks();
+        {
+            std::lock_guard lock(mutex_);
+            if (--busy_workers_ == 0) {
+                finish_.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::RunTasks() {
+    for (size_t i = next_task_++; i < task_count_; i = next_task_++) {
+        (*task_)(i);
+    }
+}
+
+}  // namespace concurrency
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+// Fixed set of worker threads for data-parallel loops.
+// The calling thread takes part in every loop, so thread_count includes it
+class ThreadPool {
+public:
+    // 0 - one thread per hardware core
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    // calls task(i) for every i in [0, task_count) and waits for all of them,
+    // at most task_count threads take part, tasks must not throw
+    void ParallelFor(size_t task_count, const std::function<void(size_t)>& task);
+
+private:
+    void Work(size_t index);
+    void RunTasks();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable finish_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t task_count_ = 0;
+    std::atomic<size_t> next_task_{0};
+    size_t generation_ = 0;
+    size_t loop_threads_ = 0;  // threads of the current loop, worker i takes part if i < loop_threads_
+    size_t busy_workers_ = 0;
+    bool stop_ = false;
+};
+
+}  // namespace concurrency
@@ -11,7 +11,7 @@ Stop* TransportCatalogue::AddStop(std::string_view name, const geo::Coordinates
     return &last_stop;
 }
 
-const Stop* TransportCatalogue::FindStop(std::string_view name) {
+const Stop* TransportCatalogue::FindStop(std::string_view name) const {
     if(auto it = stops_indx_.find(name); it != stops_indx_.end()) {
         return it->second;
     }
@@ -22,6 +22,10 @@ void TransportCatalogue::SetDistance(const Stop* from, const Stop* to, double di
     distances_.insert({{const_cast<Stop*>(from), const_cast<Stop*>(to)}, distance});
 }
 
+void TransportCatalogue::UpdateDistance(const Stop* from, const Stop* to, double distance) {
+    distances_.insert_or_assign({const_cast<Stop*>(from), const_cast<Stop*>(to)}, distance);
+}
+
 Bus* TransportCatalogue::AddBus(std::string_view name, std::deque<Stop*>&& stops, Stop* last_stop) {
     buses_.push_back({std::string(name), std::move(stops),
                       last_stop, (int)buses_.size()});
@@ -33,6 +37,20 @@ Bus* TransportCatalogue::AddBus(std::string_view name, std::deque<Stop*>&& stops
     return &last_bus;
 }
 
+const Bus* TransportCatalogue::RemoveBus(std::string_view name) {
+    auto it = buses_indx_.find(name);
+    if(it == buses_indx_.end()) return nullptr;
+    Bus* bus = it->second;
+    buses_indx_.erase(it);
+    for(auto& stop : bus->stops) {
+        if(auto itb = stops_buses_indx_.find(stop); itb != stops_buses_indx_.end()) {
+            itb->second.erase(bus);
+            if(itb->second.empty()) stops_buses_indx_.erase(itb);
+        }
+    }
+    return bus;
+}
+
 StopInfo TransportCatalogue::GetStopInfo(std::string_view stop_name) const {
     std::string name(stop_name);
     if(auto it = stops_indx_.find(stop_name); it != stops_indx_.end()) {
@@ -18,12 +18,19 @@ class TransportCatalogue {
 public:
     Stop* AddStop(std::string_view name, const geo::Coordinates coords);
 
-    const Stop* FindStop(std::string_view name);
+    const Stop* FindStop(std::string_view name) const;
 
     void SetDistance(const Stop*, const Stop*, double);
 
+    // replaces the distance set before, f.e. a detour
+    void UpdateDistance(const Stop*, const Stop*, double);
+
     Bus* AddBus(std::string_view, std::deque<Stop*>&&, Stop* last_stop = nullptr);
 
+    // drops the bus from the indices, f.e. out of service; the bus itself stays in GetBuses()
+    // for the router edges made of it. nullptr for an unknown name
+    const Bus* RemoveBus(std::string_view name);
+
     StopInfo GetStopInfo(std::string_view stop_name) const;
 
     BusInfo GetBusInfo(std::string_view bus_name) const;
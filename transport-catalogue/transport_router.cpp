@@ -1,6 +1,9 @@
 #include "transport_router.h"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <tuple>
 
 namespace transport {
 
@@ -8,35 +11,133 @@ void TransportRouter::Init(Settings settings) {
 
     settings_ = settings;
 
-    size_t i = 0;
+    // every stop has a shadow f.e. "Universam" -> "Universam_#_", see StopVertex()
     const auto& stops = catalog_.GetStops();
 
-    // add stop shadow f.e. "Universam" -> "Universam_#_"
+    // RAPTOR works on bus stops directly, the graph stays empty
+    if(settings_.engine == Engine::RAPTOR) {
+        graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(2 * stops.size());
+    } else if(settings_.graph_model == GraphModel::RIDE_VERTICES) {
+        size_t ride_count = 0;
+        for(const auto& bus : catalog_.GetBuses()) {
+            ride_count += bus.stops.size();
+        }
+        graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(2 * stops.size() + ride_count);
+        FillRideGraph();
+    } else {
+        graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(2 * stops.size());
+        FillGraph();
+    }
+    graph_->Freeze();
+    MakeRouter();
+}
+
+void TransportRouter::MakeRouter() {
+    stop_graph_.reset();
+    stop_graph_routes_.clear();
+    if(IsStopTable()) {
+        FillStopGraph();
+    }
+
+    switch (settings_.engine) {
+    case Engine::ALL_PAIRS:
+        router_ = MakeTableRouter([threads = settings_.threads, next_hops = settings_.next_hops](const auto& graph) {
+            return graph::MakeEngine<graph::Router>(graph, threads, next_hops);
+        });
+        break;
+    case Engine::DIJKSTRA:
+        router_ = std::make_unique<graph::DijkstraRouter<double>>(*graph_, settings_.tree_cache_bytes);
+        break;
+    case Engine::CONTRACTION_HIERARCHY:
+        router_ = std::make_unique<graph::ContractionHierarchy<double>>(*graph_);
+        break;
+    case Engine::ALL_PAIRS_DENSE:
+        router_ = MakeTableRouter([threads = settings_.threads](const auto& graph) {
+            return graph::MakeEngine<graph::DenseRouter>(graph, threads);
+        });
+        break;
+    case Engine::RAPTOR:
+        router_.reset();
+        raptor_ = std::make_unique<RaptorRouter>(catalog_, settings_.wait, settings_.velocity, removed_buses_);
+        break;
+    case Engine::A_STAR:
+        router_ = std::make_unique<graph::AStarRouter<double>>(*graph_, MakeHeuristic());
+        break;
+    case Engine::BIDIRECTIONAL_DIJKSTRA:
+        router_ = std::make_unique<graph::BidirectionalDijkstraRouter<double>>(*graph_);
+        break;
+    case Engine::HUB_LABELING:
+        router_ = std::make_unique<graph::HubLabeling<double>>(*graph_);
+        break;
+    }
+}
+
+void TransportRouter::FillStopGraph() {
+    std::vector<graph::VertexId> stop_vertices;
+    stop_vertices.reserve(catalog_.GetStops().size());
+    for(const Stop& stop : catalog_.GetStops()) {
+        stop_vertices.push_back(StopVertex(&stop));
+    }
+    auto condensed = graph::CondenseGraph(*graph_, stop_vertices);
+
+    if(!stop_graph_) {
+        stop_graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>();
+    }
+    *stop_graph_ = std::move(condensed.graph);
+    stop_graph_routes_ = std::move(condensed.routes);
+}
+
+graph::AStarRouter<double>::Heuristic TransportRouter::MakeHeuristic() {
+    const auto& stops = catalog_.GetStops();
+
+    // stop and shadow of stop i are 2 * i and 2 * i + 1, ride vertices take the stop of
+    // their wait or alight edge, works the same for a graph loaded from the base
+    vertex_stops_.assign(graph_->GetVertexCount(), nullptr);
     for(const Stop& stop : stops) {
-        stops_.insert({stop.name, i++});
-        stops_.insert({stop.name + STOP_SUFFIX, i++});
+        vertex_stops_[StopVertex(&stop)] = vertex_stops_[ShadowVertex(&stop)] = &stop;
+    }
+    for(graph::EdgeId id = 0; id < edges_.size(); ++id) {
+        const auto& edge = graph_->GetEdge(id);
+        if(edges_[id].type == EdgeType::WAIT) {
+            vertex_stops_[edge.to] = edges_[id].from;
+        } else if(edges_[id].type == EdgeType::ALIGHT) {
+            vertex_stops_[edge.from] = edges_[id].to;
+        }
+    }
+
+    // road distance may be shorter than the great-circle one (rounded input),
+    // the smallest ratio over bus segments keeps the bound admissible
+    double ratio = 1.0;
+    for(const auto& bus : catalog_.GetBuses()) {
+        for(size_t i = 1; i < bus.stops.size(); ++i) {
+            const double geo = geo::ComputeDistance(bus.stops[i - 1]->coordinates, bus.stops[i]->coordinates);
+            if(geo > 0.0) {
+                ratio = std::min(ratio, catalog_.GetDistance(bus.stops[i - 1], bus.stops[i]) / geo);
+            }
+        }
     }
+    // minutes per meter, a little below to stay a bound after rounding
+    const double scale = ratio * (1.0 - 1e-9) * 60.0 / 1000 / settings_.velocity;
 
-    graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(2 * catalog_.GetStops().size());
-    FillGraph();
-    router_ = std::make_unique<graph::Router<double>>(*graph_);
+    return [this, scale](graph::VertexId vertex, graph::VertexId target) {
+        return scale * geo::ComputeDistance(vertex_stops_[vertex]->coordinates, vertex_stops_[target]->coordinates);
+    };
 }
 
-void TransportRouter::AddEdges(EdgeIdx edge_idx, std::vector<double>& span_time) {
+void TransportRouter::MakeSpanEdges(EdgeIdx edge_idx, std::vector<double>& span_time, const EdgeSink& sink) const {
 
-    size_t from = stops_.at(edge_idx.from->name);
-    size_t from_suff = stops_.at(edge_idx.from->name + STOP_SUFFIX);
+    size_t from = StopVertex(edge_idx.from);
+    size_t from_suff = ShadowVertex(edge_idx.from);
 
     // 1) add edge for stop -> shadow
     // f.e. (enter)"Universam" (wait bus)-> (leave)"Universam_#_"
     // A - B - C here A - A_#_
-    graph_->AddEdge({from, from_suff, settings_.wait});
-    edges_.push_back({edge_idx.bus, edge_idx.from, edge_idx.from, settings_.wait, 0});
+    sink({from, from_suff, settings_.wait},
+         {edge_idx.bus, edge_idx.from, edge_idx.from, settings_.wait, 0, EdgeType::WAIT});
 
     // 2) add edge (span etc.) for each bus stops pair
     // A - B - C here A_#_ - B
-    graph_->AddEdge({from_suff, stops_.at(edge_idx.to->name), edge_idx.time});
-    edges_.push_back(edge_idx);
+    sink({from_suff, StopVertex(edge_idx.to), edge_idx.time}, edge_idx);
 
     // 3) additional edges for bus: from {begin() ... current - 2}, to{current}
     // A - B - C here A_#_ - C , two span: (A - B) + (B - C)
@@ -47,78 +148,332 @@ void TransportRouter::AddEdges(EdgeIdx edge_idx, std::vector<double>& span_time)
 
         auto stop = *it++;
 
-        size_t from_suff = stops_.at(stop->name + STOP_SUFFIX);
-        graph_->AddEdge({from_suff, stops_.at(edge_idx.to->name), span_time[i]});
-        edges_.push_back({edge_idx.bus, stop, edge_idx.to, span_time[i], span});
+        sink({ShadowVertex(stop), StopVertex(edge_idx.to), span_time[i]},
+             {edge_idx.bus, stop, edge_idx.to, span_time[i], span});
     }
 }
 
+void TransportRouter::MakeBusEdges(const Bus& bus, graph::VertexId first_ride, const EdgeSink& sink) const {
+    Bus* bus_ptr = const_cast<Bus*>(&bus);
+
+    if(settings_.graph_model == GraphModel::RIDE_VERTICES) {
+        // stop -(wait)-> ride vertex -(ride)-> next ride vertex ... -(0)-> stop
+        graph::VertexId ride = first_ride;
+        Stop* from = nullptr;
+        for(size_t i = 0; i < bus.stops.size(); ++i, ++ride) {
+            Stop* to = bus.stops[i];
+            const size_t stop = StopVertex(to);
+
+            if(from != nullptr) {
+                double time = 60.0 * catalog_.GetDistance(from, to) / 1000 / settings_.velocity;
+                sink({ride - 1, ride, time}, {bus_ptr, from, to, time, 1, EdgeType::BUS});
+                sink({ride, stop, 0.0}, {bus_ptr, to, to, 0.0, 0, EdgeType::ALIGHT});
+            }
+            // no boarding at the last stop
+            if(i + 1 < bus.stops.size()) {
+                sink({stop, ride, settings_.wait}, {bus_ptr, to, to, settings_.wait, 0, EdgeType::WAIT});
+            }
+            from = to;
+        }
+        return;
+    }
+
+    Stop *from, *to;
+    bool first_step = true;
+
+    std::vector<double> span_time;
+    span_time.reserve(bus.stops.size());
+
+    for(auto& stop : bus.stops) {
+        to = stop;
+        if(first_step) {
+            first_step = false;
+            from = to;
+            continue;
+        }
+
+        double dist = catalog_.GetDistance(from, to);
+        double time = 60.0 * dist / 1000 / settings_.velocity;
+
+        /*
+         * for MakeSpanEdges() p. 3)
+         * A B C
+         * +
+         * + +
+         * + + +
+        */
+        span_time.push_back(0.0);
+        for(auto& span_time : span_time) {
+            span_time += time;
+        }
+
+        MakeSpanEdges({bus_ptr, from, to, time}, span_time, sink);
+        from = to;
+    }
+}
+
+void TransportRouter::AddBusEdges(const Bus& bus, graph::VertexId first_ride) {
+    MakeBusEdges(bus, first_ride, [this](const graph::Edge<double>& edge, const EdgeIdx& edge_idx) {
+        graph_->AddEdge(edge);
+        edges_.push_back(edge_idx);
+    });
+}
+
 void TransportRouter::FillGraph() {
     for(const auto& bus : catalog_.GetBuses()) {
-        Stop *from, *to;
-        bool first_step = true;
-
-        std::vector<double> span_time;
-        span_time.reserve(bus.stops.size());
-
-        for(auto& stop : bus.stops) {
-            to = stop;
-            if(first_step) {
-                first_step = false;
-                from = to;
-                continue;
+        AddBusEdges(bus, 0);
+    }
+}
+
+void TransportRouter::FillRideGraph() {
+    // ride vertices go after stops and shadows, one for every stop of every bus
+    graph::VertexId ride = 2 * catalog_.GetStops().size();
+    for(const auto& bus : catalog_.GetBuses()) {
+        AddBusEdges(bus, ride);
+        ride += bus.stops.size();
+    }
+}
+
+void TransportRouter::ApplyUpdate(const Update& update) {
+    for(const Bus* bus : update.removed_buses) {
+        removed_buses_.insert(bus);
+    }
+
+    // RAPTOR reads the catalogue directly
+    if(settings_.engine == Engine::RAPTOR) {
+        MakeRouter();
+        return;
+    }
+
+    // edges of a bus get ids one after another, see FillGraph()
+    std::unordered_map<const Bus*, std::pair<graph::EdgeId, graph::EdgeId>> bus_edges;
+    for(graph::EdgeId id = 0; id < edges_.size(); ++id) {
+        auto [it, _] = bus_edges.try_emplace(edges_[id].bus, id, id);
+        it->second.second = id + 1;
+    }
+
+    std::vector<graph::EdgeId> changed_edges;
+    graph_->Thaw();
+
+    for(const Bus* bus : update.removed_buses) {
+        if(const auto it = bus_edges.find(bus); it != bus_edges.end()) {
+            for(graph::EdgeId id = it->second.first; id < it->second.second; ++id) {
+                if(graph_->HasEdge(id)) {
+                    graph_->RemoveEdge(id);
+                    changed_edges.push_back(id);
+                }
             }
+        }
+    }
 
-            double dist = catalog_.GetDistance(from, to);
-            double time = 60.0 * dist / 1000 / settings_.velocity;
-
-            /*
-             * for AddEdges() p. 3)
-             * A B C
-             * +
-             * + +
-             * + + +
-            */
-            span_time.push_back(0.0);
-            for(auto& span_time : span_time) {
-                span_time += time;
+    // times of the buses through changed stop pairs are made again in the same edge order,
+    // vertices are not used here
+    for(const auto& [bus, range] : bus_edges) {
+        if(removed_buses_.count(bus) != 0) continue;
+        bool is_affected = false;
+        for(size_t i = 1; i < bus->stops.size() && !is_affected; ++i) {
+            for(const auto& [from, to] : update.distances) {
+                if((bus->stops[i - 1] == from && bus->stops[i] == to)
+                   || (bus->stops[i - 1] == to && bus->stops[i] == from)) {
+                    is_affected = true;
+                    break;
+                }
             }
+        }
+        if(!is_affected) continue;
 
-            AddEdges({const_cast<Bus*>(&bus), from, to, time}, span_time);
-            from = to;
+        graph::EdgeId id = range.first;
+        MakeBusEdges(*bus, 0, [&](const graph::Edge<double>& edge, const EdgeIdx& edge_idx) {
+            if(graph_->GetEdge(id).weight != edge.weight) {
+                graph_->SetEdgeWeight(id, edge.weight);
+                edges_[id].time = edge_idx.time;
+                changed_edges.push_back(id);
+            }
+            ++id;
+        });
+    }
+
+    for(const Bus* bus : update.added_buses) {
+        if(bus_edges.count(bus) != 0) {
+            throw std::invalid_argument("Bus is already routed");
         }
+        const graph::VertexId first_ride = graph_->GetVertexCount();
+        if(settings_.graph_model == GraphModel::RIDE_VERTICES) {
+            for(size_t i = 0; i < bus->stops.size(); ++i) {
+                graph_->AddVertex();
+            }
+        }
+        const graph::EdgeId first_edge = edges_.size();
+        AddBusEdges(*bus, first_ride);
+        for(graph::EdgeId id = first_edge; id < edges_.size(); ++id) {
+            changed_edges.push_back(id);
+        }
+    }
+
+    graph_->Freeze();
+    // the stop graph is condensed again with the tables
+    if(stop_graph_ || !router_->Update(changed_edges)) {
+        MakeRouter();
+    }
+}
+
+const Stop* TransportRouter::GetStop(std::string_view name) const {
+    const Stop* stop = catalog_.FindStop(name);
+    if(stop == nullptr) {
+        throw std::out_of_range("Unknown stop");
     }
+    return stop;
 }
 
 std::optional<TransportRouter::Route> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
-    auto route =  router_->BuildRoute(stops_.at(std::string(from)),
-                                      stops_.at(std::string(to)));
-    if(route == std::nullopt) {
+    if(raptor_) {
+        return BuildRaptorRoute(from, to);
+    }
+
+    // buffers are reused between queries of the thread
+    thread_local std::vector<graph::EdgeId> route_edges;
+    thread_local std::vector<graph::EdgeId> graph_edges;
+    route_edges.clear();
+    const auto weight = router_->AppendRoute(RouterVertex(GetStop(from)),
+                                             RouterVertex(GetStop(to)), route_edges);
+    if(weight == std::nullopt) {
         return std::nullopt;
     }
 
+    // stop graph edges back to the edges of graph_
+    const std::vector<graph::EdgeId>* edges = &route_edges;
+    if(stop_graph_) {
+        graph_edges.clear();
+        for(const auto edge_id : route_edges) {
+            const auto& edge_route = stop_graph_routes_[edge_id];
+            graph_edges.insert(graph_edges.end(), edge_route.begin(), edge_route.end());
+        }
+        edges = &graph_edges;
+    }
+
     Route answer;
-    answer.total_time = route->weight;
+    answer.total_time = *weight;
+    answer.items.reserve(edges->size());
 
-    for(const auto& stop : route->edges) {
-        auto edge_idx = edges_.at(stop);
+    // consecutive ride edges of the ride vertex model make one Bus item
+    bool on_bus = false;
+    for(const auto edge_id : *edges) {
+        const auto& edge_idx = edges_.at(edge_id);
 
-        if(edge_idx.span == 0) {
-            answer.items.push_back({
-                                    {"stop_name"s, edge_idx.from->name},
-                                    {"time"s, edge_idx.time},
-                                    {"type"s, "Wait"s}
-                                });
+        if(edge_idx.type == EdgeType::WAIT) {
+            answer.items.push_back({ItemType::WAIT, edge_idx.from, nullptr, 0, edge_idx.time});
+            on_bus = false;
+        } else if(edge_idx.type == EdgeType::ALIGHT) {
+            on_bus = false;
+        } else if(on_bus) {
+            auto& item = answer.items.back();
+            item.span_count += (int)edge_idx.span;
+            item.time += edge_idx.time;
         } else {
-            answer.items.push_back({
-                                    {"bus"s, edge_idx.bus->name},
-                                    {"span_count"s, (int)edge_idx.span},
-                                    {"time"s, edge_idx.time},
-                                    {"type"s, "Bus"s}
-                                });
+            answer.items.push_back({ItemType::BUS, nullptr, edge_idx.bus, (int)edge_idx.span, edge_idx.time});
+            on_bus = true;
         }
     }
     return answer;
 }
 
+std::optional<TransportRouter::Route> TransportRouter::BuildRaptorRoute(std::string_view from, std::string_view to) const {
+    auto journey = raptor_->BuildRoute(GetStop(from)->id, GetStop(to)->id);
+    if(journey == std::nullopt) {
+        return std::nullopt;
+    }
+
+    Route answer;
+    answer.total_time = journey->total_time;
+    answer.items.reserve(2 * journey->legs.size());
+
+    for(const auto& leg : journey->legs) {
+        answer.items.push_back({ItemType::WAIT, leg.from, nullptr, 0, settings_.wait});
+        answer.items.push_back({ItemType::BUS, nullptr, leg.bus, (int)leg.span_count, leg.time});
+    }
+    return answer;
+}
+
+TransportRouter::Matrix TransportRouter::BuildMatrix(const std::vector<std::string_view>& from,
+                                                     const std::vector<std::string_view>& to) const {
+    // names are resolved before the parallel part, pool tasks must not throw
+    std::vector<const Stop*> from_stops;
+    from_stops.reserve(from.size());
+    for(const auto name : from) {
+        from_stops.push_back(GetStop(name));
+    }
+    std::vector<size_t> to_ids;
+    std::vector<graph::VertexId> to_vertices;
+    to_ids.reserve(to.size());
+    to_vertices.reserve(to.size());
+    for(const auto name : to) {
+        const Stop* stop = GetStop(name);
+        to_ids.push_back(stop->id);
+        to_vertices.push_back(RouterVertex(stop));
+    }
+
+    Matrix matrix(from_stops.size());
+    const auto build_row = [&](size_t row) {
+        if(raptor_) {
+            matrix[row] = raptor_->BuildTimes(from_stops[row]->id, to_ids);
+        } else {
+            matrix[row] = router_->BuildWeights(RouterVertex(from_stops[row]), to_vertices);
+        }
+    };
+
+    // no more threads than rows, the pool grows with the requests up to a thread per core
+    const size_t thread_count = std::min<size_t>(from_stops.size(),
+                                                 std::max(1u, std::thread::hardware_concurrency()));
+    if(thread_count < 2) {
+        for(size_t row = 0; row < from_stops.size(); ++row) {
+            build_row(row);
+        }
+        return matrix;
+    }
+    if(!matrix_pool_ || matrix_pool_->GetThreadCount() < thread_count) {
+        matrix_pool_ = std::make_unique<concurrency::ThreadPool>(thread_count);
+    }
+    matrix_pool_->ParallelFor(from_stops.size(), build_row);
+    return matrix;
+}
+
+TransportRouter::Isochrone TransportRouter::BuildIsochrone(std::string_view from, double max_time) const {
+    const Stop* from_stop = GetStop(from);
+    const auto& stops = catalog_.GetStops();
+
+    Isochrone isochrone;
+    if(raptor_) {
+        for(const auto& [stop_id, time] : raptor_->BuildReachable(from_stop->id, max_time)) {
+            isochrone.push_back({&stops[stop_id], time});
+        }
+    } else {
+        // shadows and ride vertices are passed through, stop i is vertex 2 * i
+        for(const auto& [vertex, time] : graph::FindReachable(*graph_, StopVertex(from_stop), max_time)) {
+            if(vertex < 2 * stops.size() && vertex % 2 == 0) {
+                isochrone.push_back({&stops[vertex / 2], time});
+            }
+        }
+    }
+
+    std::sort(isochrone.begin(), isochrone.end(), [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.second, lhs.first->name) < std::tie(rhs.second, rhs.first->name);
+    });
+    return isochrone;
+}
+
+TransportRouter::Stats TransportRouter::GetStats() const {
+    Stats stats;
+    if(const auto dijkstra = dynamic_cast<const graph::DijkstraRouter<double>*>(router_.get())) {
+        stats.tree_cache = dijkstra->GetCacheStats();
+        stats.search = dijkstra->GetSearchStats();
+    } else if(const auto a_star = dynamic_cast<const graph::AStarRouter<double>*>(router_.get())) {
+        stats.search = a_star->GetSearchStats();
+    } else if(const auto bidirectional = dynamic_cast<const graph::BidirectionalDijkstraRouter<double>*>(router_.get())) {
+        stats.search = bidirectional->GetSearchStats();
+    } else if(const auto hub_labeling = dynamic_cast<const graph::HubLabeling<double>*>(router_.get())) {
+        stats.hub_labels = hub_labeling->GetLabelStats();
+    }
+    return stats;
+}
+
 } // namespace transport
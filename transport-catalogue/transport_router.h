@@ -2,18 +2,36 @@
 
 #include "geo.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "astar_router.h"
+#include "bidirectional_dijkstra_router.h"
+#include "condensed_graph.h"
+#include "converted_router.h"
+#include "contraction_hierarchy.h"
+#include "hub_labeling.h"
+#include "dense_router.h"
+#include "raptor_router.h"
 #include "transport_catalogue.h"
 #include "serialization.h"
+#include "thread_pool.h"
 
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
-#include <variant>
 #include <optional>
+#include <functional>
 #include <memory>
+#include <utility>
 
 using namespace std::literals;
 
+namespace mapped {
+    class File;
+}
+
 namespace transport {
 
 class TransportCatalogue;
@@ -22,21 +40,94 @@ class TransportRouter {
 
     friend class Serial;
 
-const std::string STOP_SUFFIX = "_#_"s;
-
-using RouteInfo = std::optional<graph::Router<double>::RouteInfo>;
+using RouteInfo = std::optional<graph::RouteInfo<double>>;
 
 public:
 
+    // ALL_PAIRS - Floyd–Warshall table at make_base, DIJKSTRA - search per query,
+    // CONTRACTION_HIERARCHY - shortcuts at make_base, bidirectional search per query,
+    // ALL_PAIRS_DENSE - Floyd–Warshall with flat table,
+    // RAPTOR - rounds over bus stop sequences per query, no span edges in the graph,
+    // A_STAR - search per query directed by the great-circle distance to the target,
+    // BIDIRECTIONAL_DIJKSTRA - searches from both ends per query, reverse graph in memory,
+    // HUB_LABELING - hub labels at make_base, two sorted labels merged per query
+    enum class Engine {
+        ALL_PAIRS,
+        DIJKSTRA,
+        CONTRACTION_HIERARCHY,
+        ALL_PAIRS_DENSE,
+        RAPTOR,
+        A_STAR,
+        BIDIRECTIONAL_DIJKSTRA,
+        HUB_LABELING,
+    };
+
+    // SPAN_EDGES - edge for every pair of stops of a bus, O(len^2) per bus,
+    // RIDE_VERTICES - vertex for every stop of a bus linked by ride edges, O(len) per bus
+    enum class GraphModel {
+        SPAN_EDGES,
+        RIDE_VERTICES,
+    };
+
+    // weights of the ALL_PAIRS and ALL_PAIRS_DENSE tables, other engines work in double.
+    // FLOAT - every edge and every sum rounds with relative error <= 2^-24, a route of k edges
+    // and weight W is off by at most 2k * 2^-24 * W;
+    // FIXED - uint32 in centiseconds (FIXED_UNITS_PER_MINUTE), only edges are rounded, by half a unit:
+    // a route of k edges is off by at most k / 12000 minutes, routes up to ~715000 minutes.
+    // Answers: a route chosen by the table is at most twice the bound longer than the shortest one,
+    // its total time is summed in double; Matrix cells are the table weights
+    enum class WeightType {
+        DOUBLE,
+        FLOAT,
+        FIXED,
+    };
+
+    static constexpr double FIXED_UNITS_PER_MINUTE = 6000.0;
+
     struct Settings {
         double wait = 0.0;
         double velocity = 0.0;
+        Engine engine = Engine::ALL_PAIRS;
+        // threads of the all-pairs engines at make_base, 0 - all cores
+        size_t threads = 1;
+        // memory budget of the shortest-path tree cache of DIJKSTRA, 0 - no cache
+        size_t tree_cache_bytes = 0;
+        GraphModel graph_model = GraphModel::SPAN_EDGES;
+        // tables of ALL_PAIRS and ALL_PAIRS_DENSE over stop vertices only, (V / N)^2 times smaller;
+        // shadows and ride vertices are passed through by the stop graph edges
+        bool stop_vertices_only = false;
+        WeightType weight_type = WeightType::DOUBLE;
+        // next-hop table of ALL_PAIRS besides the prev edges, V^2 uint32 more, built at load
+        bool next_hops = false;
+        // slots of the cache of formatted Route answers at process_requests, 0 - no cache
+        size_t route_cache_entries = 0;
+    };
+
+    // counters for monitoring, engine-specific parts are empty for other engines
+    struct Stats {
+        std::optional<graph::TreeCacheStats> tree_cache;
+        // settled vertices of the per-query searches
+        std::optional<graph::SearchStats> search;
+        // label sizes of HUB_LABELING, they make the most of the base file
+        std::optional<graph::HubLabelStats> hub_labels;
+    };
+
+    enum class ItemType {
+        WAIT,
+        BUS,
     };
 
-    using ItemValue = std::variant<std::string, int, double>;
+    // WAIT - `stop` and time, BUS - `bus`, span_count and time
+    struct RouteItem {
+        ItemType type;
+        const Stop* stop = nullptr;
+        const Bus* bus = nullptr;
+        int span_count = 0;
+        double time = 0.0;
+    };
 
     struct Route {
-        std::vector<std::unordered_map<std::string, ItemValue>> items;
+        std::vector<RouteItem> items;
         double total_time;
     };
 
@@ -44,28 +135,154 @@ public:
 
     void Init(Settings);
 
+    const Settings& GetSettings() const {
+        return settings_;
+    }
+
     std::optional<Route> BuildRoute(std::string_view from, std::string_view to) const;
 
+    // total times, row for every stop of `from`, std::nullopt for no route
+    using Matrix = std::vector<std::vector<std::optional<double>>>;
+
+    // one-to-many search per origin, origins run in parallel on up to a thread per core
+    Matrix BuildMatrix(const std::vector<std::string_view>& from, const std::vector<std::string_view>& to) const;
+
+    // stops reachable within max_time with their total times, sorted by time and name
+    using Isochrone = std::vector<std::pair<const Stop*, double>>;
+
+    // bounded search from the stop, independent of the engine's tables
+    Isochrone BuildIsochrone(std::string_view from, double max_time) const;
+
+    // changes of the catalogue after the graph is built, f.e. a closed road gets a detour distance
+    struct Update {
+        // stop pairs with a new road distance in the catalogue (either direction)
+        std::vector<std::pair<const Stop*, const Stop*>> distances;
+        // buses added to the catalogue
+        std::vector<const Bus*> added_buses;
+        // buses out of service, removed from the catalogue indices, the Bus objects stay
+        std::vector<const Bus*> removed_buses;
+    };
+
+    // edits the graph in place (edge ids stay) and lets the engine repair itself:
+    // all-pairs tables recompute only the rows which may change, the tree cache drops only
+    // such trees, CH and A* are built again. Edits are in memory, the base file keeps the original
+    void ApplyUpdate(const Update& update);
+
+    Stats GetStats() const;
+
 private:
 
+    // WAIT - wait (and board) at `from`, BUS - ride `span` stops,
+    // ALIGHT - leave a ride vertex, not shown in the route
+    enum class EdgeType {
+        WAIT,
+        BUS,
+        ALIGHT,
+    };
+
     struct EdgeIdx {
         Bus* bus;
         Stop* from;
         Stop* to;
         double time;
         size_t span = 1;
+        EdgeType type = EdgeType::BUS;
     };
 
+    // stop id i -> vertex 2 * i, its shadow -> 2 * i + 1
+    static graph::VertexId StopVertex(const Stop* stop) {
+        return 2 * static_cast<graph::VertexId>(stop->id);
+    }
+
+    static graph::VertexId ShadowVertex(const Stop* stop) {
+        return StopVertex(stop) + 1;
+    }
+
+    // stop of a request, throws std::out_of_range for unknown names
+    const Stop* GetStop(std::string_view name) const;
+
+    using EdgeSink = std::function<void(const graph::Edge<double>&, const EdgeIdx&)>;
+
+    // edges of one bus in the order they get ids, ride vertices of the bus start at first_ride
+    void MakeBusEdges(const Bus& bus, graph::VertexId first_ride, const EdgeSink& sink) const;
+
+    void MakeSpanEdges(EdgeIdx, std::vector<double>&, const EdgeSink& sink) const;
+
+    void AddBusEdges(const Bus& bus, graph::VertexId first_ride);
+
     void FillGraph();
 
-    void AddEdges(EdgeIdx, std::vector<double>&);
+    void FillRideGraph();
+
+    void MakeRouter();
+
+    bool IsStopTable() const {
+        return settings_.stop_vertices_only
+               && (settings_.engine == Engine::ALL_PAIRS || settings_.engine == Engine::ALL_PAIRS_DENSE);
+    }
+
+    // condenses graph_ into stop_graph_ (same object if it exists), see IsStopTable()
+    void FillStopGraph();
+
+    // graph of the table engines: stop graph (stop i is vertex i) or graph_
+    const graph::DirectedWeightedGraph<double>& GetTableGraph() const {
+        return stop_graph_ ? *stop_graph_ : *graph_;
+    }
+
+    // table engine over GetTableGraph() with the weights of settings_.weight_type,
+    // make_table(graph) gets the graph with the chosen weights, f.e. graph::MakeEngine<graph::Router>
+    template <typename MakeTable>
+    std::unique_ptr<graph::RouterEngine<double>> MakeTableRouter(MakeTable make_table) const;
+
+    graph::VertexId RouterVertex(const Stop* stop) const {
+        return stop_graph_ ? static_cast<graph::VertexId>(stop->id) : StopVertex(stop);
+    }
+
+    // lower bound of the travel time between vertices by the great-circle distance
+    graph::AStarRouter<double>::Heuristic MakeHeuristic();
+
+    std::optional<Route> BuildRaptorRoute(std::string_view from, std::string_view to) const;
 
     const TransportCatalogue& catalog_;
-    Settings settings_{0.0, 0.0};
+    Settings settings_{0.0, 0.0, Engine::ALL_PAIRS};
     std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_;
-    std::unique_ptr<graph::Router<double>> router_;
-    std::unordered_map<std::string, size_t> stops_;
+    std::unique_ptr<graph::RouterEngine<double>> router_;
+    std::unique_ptr<graph::DirectedWeightedGraph<double>> stop_graph_;
+    std::vector<std::vector<graph::EdgeId>> stop_graph_routes_;  // edges of graph_ for stop graph edges
+    std::unique_ptr<RaptorRouter> raptor_;
     std::vector<EdgeIdx> edges_;
+    std::vector<const Stop*> vertex_stops_;  // stop of every vertex, for A_STAR
+    std::unordered_set<const Bus*> removed_buses_;
+    std::shared_ptr<const mapped::File> base_file_;  // mapped base, the table may be read in place
+    // workers of Matrix requests, made by the first one and kept for the next ones
+    mutable std::unique_ptr<concurrency::ThreadPool> matrix_pool_;
 };
 
+template <typename MakeTable>
+std::unique_ptr<graph::RouterEngine<double>> TransportRouter::MakeTableRouter(MakeTable make_table) const {
+    switch(settings_.weight_type) {
+    case WeightType::FLOAT:
+        return std::make_unique<graph::ConvertedRouter<float>>(
+                    GetTableGraph(),
+                    [](double weight) { return static_cast<float>(weight); },
+                    [](float weight) { return static_cast<double>(weight); },
+                    make_table);
+    case WeightType::FIXED:
+        return std::make_unique<graph::ConvertedRouter<uint32_t>>(
+                    GetTableGraph(),
+                    [](double weight) {
+                        const double units = std::round(weight * FIXED_UNITS_PER_MINUTE);
+                        if(units >= graph::WeightTraits<uint32_t>::UNREACHABLE) {
+                            throw std::out_of_range("Weight doesn't fit the fixed-point table");
+                        }
+                        return static_cast<uint32_t>(units);
+                    },
+                    [](uint32_t weight) { return weight / FIXED_UNITS_PER_MINUTE; },
+                    make_table);
+    case WeightType::DOUBLE:
+        break;
+    }
+    return make_table(GetTableGraph());
+}
+
 }
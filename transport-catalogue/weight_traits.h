@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace graph {
+
+// Weights of the flat tables (Floyd–Warshall kernels, DenseRouter).
+// Floating point: +inf for no route, sums are plain additions in Weight.
+// Fixed point (unsigned integers up to 32 bits): max for no route, sums are taken in the wider
+// Accumulator and saturate at UNREACHABLE, so "no route + w" stays "no route" and relaxation
+// is integer-only
+template <typename Weight, typename = void>
+struct WeightTraits;
+
+template <typename Weight>
+struct WeightTraits<Weight, std::enable_if_t<std::is_floating_point_v<Weight>>> {
+    using Accumulator = Weight;
+
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::infinity();
+
+    static Weight Add(Weight lhs, Weight rhs) {
+        return lhs + rhs;
+    }
+};
+
+template <typename Weight>
+struct WeightTraits<Weight, std::enable_if_t<std::is_unsigned_v<Weight>>> {
+    static_assert(sizeof(Weight) <= sizeof(uint32_t), "Fixed-point sums need a wider accumulator");
+
+    using Accumulator = uint64_t;
+
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+
+    static Weight Add(Weight lhs, Weight rhs) {
+        const Accumulator sum = Accumulator{lhs} + Accumulator{rhs};
+        return sum < Accumulator{UNREACHABLE} ? static_cast<Weight>(sum) : UNREACHABLE;
+    }
+};
+
+}  // namespace graph